@@ -0,0 +1,329 @@
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../typedefs.h"
+#include "../cityjson_reader.h"
+#include "../darts_writer.h"
+#include "../mesh_writer.h"
+#include "../lcc_binary.h"
+#include "../lcc_snapshot.h"
+#include "../lcc_statistics.h"
+#include "synthetic_cityjson.h"
+
+using namespace std;
+
+// Reconstructs synthetic city models of each layout, as solids and as
+// multi-surfaces, with each of the reconstruction modes of the tool, exports
+// them and reports the throughput of each step. Every configuration runs in
+// a child process of its own, so that its peak memory is its own.
+//
+// Usage: cityjson2lcc_bench [object_count...] (default 1000 10000)
+
+typedef Run_stats::Clock Clock;
+
+// Every allocation of the process, counted by the replaced global operator
+// new, so that a step's allocations are the difference around it
+std::atomic<uint64_t> allocation_count(0);
+
+void* operator new(size_t size)
+{
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  void* p = malloc(size > 0 ? size : 1);
+  if (p == nullptr)
+  {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void* p) noexcept
+{
+  free(p);
+}
+
+double seconds_since(Clock::time_point start)
+{
+  return chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Options of the tool a configuration reconstructs with
+struct Bench_mode
+{
+  const char* name;
+  bool integer_matching;
+  bool stream;
+  int threads;  // -j, or -1 without it
+  double tile_size;
+};
+
+const Bench_mode bench_modes[] = {
+  {"-q", true, false, -1, 0},
+  {"-p 3", false, false, -1, 0},
+  {"-q --stream", true, true, -1, 0},
+  {"-q -j 0", true, false, 0, 0},
+  {"-q -t 200", true, false, -1, 200}
+};
+
+// Peak resident set size of the process so far, in MB
+double peak_rss_mb()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+  return usage.ru_maxrss / 1024.0;
+#endif
+}
+
+// The traversal of the reader before it read the document in place: each
+// function took its part of the document by value, so that every object,
+// geometry, shell, polygon, ring and vertex was copied on the way down.
+// Only the copies are reproduced, to count what they allocated.
+struct Old_parse_chain
+{
+  nlohmann::json city_model;
+
+  void point(nlohmann::json p)
+  {
+    (void)p;
+  }
+
+  void vertices(nlohmann::json ring)
+  {
+    for (int i : ring)
+    {
+      point(city_model["vertices"][i]);
+    }
+  }
+
+  void polygon(nlohmann::json poly)
+  {
+    vertices(poly[0]);
+  }
+
+  void shell(nlohmann::json surfaces)
+  {
+    for (auto& poly : surfaces)
+    {
+      polygon(poly);
+    }
+  }
+
+  void geometry(nlohmann::json geom)
+  {
+    if (geom["type"] == "Solid")
+    {
+      for (auto& solid_shell : geom["boundaries"])
+      {
+        shell(solid_shell);
+      }
+    }
+    else
+    {
+      shell(geom["boundaries"]);
+    }
+  }
+
+  void read(nlohmann::json city)
+  {
+    city_model = city;
+
+    map<string, nlohmann::json> objects = city["CityObjects"];
+    for (auto& obj : objects)
+    {
+      auto obj_content = obj.second;
+      for (auto& geom : obj_content["geometry"])
+      {
+        geometry(geom);
+      }
+    }
+  }
+};
+
+// Times the exports of lcc, and the reload and queries of the binary one
+void run_exports(const LCC& lcc)
+{
+  Clock::time_point start = Clock::now();
+  {
+    ofstream output("bench_darts.json");
+    write_darts(output, lcc);
+  }
+  double darts_export = seconds_since(start);
+
+  start = Clock::now();
+  {
+    ofstream output("bench.off");
+    write_mesh_off(output, lcc);
+  }
+  double off_export = seconds_since(start);
+
+  start = Clock::now();
+  {
+    ofstream output("bench.ply", ios::binary);
+    write_mesh_ply(output, lcc);
+  }
+  double ply_export = seconds_since(start);
+
+  start = Clock::now();
+  save_combinatorial_map(lcc, "bench.3map");
+  double cmap_export = seconds_since(start);
+
+  start = Clock::now();
+  save_lcc_binary(lcc, "bench.lccb");
+  double binary_export = seconds_since(start);
+
+  start = Clock::now();
+  LCC reloaded = load_lcc_binary("bench.lccb");
+  double binary_load = seconds_since(start);
+
+  start = Clock::now();
+  size_t snapshot_faces, snapshot_darts = 0;
+  {
+    Lcc_snapshot snapshot("bench.lccb");
+    vector<uint32_t> faces = snapshot.faces_of_object("building_0");
+    snapshot_faces = faces.size();
+    for (uint32_t f : faces)
+    {
+      snapshot_darts += snapshot.darts_of_face(f).size();
+    }
+  }
+  double snapshot_query = seconds_since(start);
+
+  remove("bench_darts.json");
+  remove("bench.off");
+  remove("bench.ply");
+  remove("bench.3map");
+  remove("bench.lccb");
+
+  double darts = static_cast<double>(lcc.number_of_darts());
+  cout << "  +darts: " << darts_export << " s, " << darts / darts_export << " darts/s" << endl
+       << "  off: " << off_export << " s, " << darts / off_export << " darts/s" << endl
+       << "  ply: " << ply_export << " s, " << darts / ply_export << " darts/s" << endl
+       << "  3map: " << cmap_export << " s, " << darts / cmap_export << " darts/s" << endl
+       << "  lccb: " << binary_export << " s, " << darts / binary_export << " darts/s, reloaded "
+       << reloaded.number_of_darts() << " darts in " << binary_load << " s" << endl
+       << "  snapshot: mapped and found " << snapshot_faces << " faces and " << snapshot_darts
+       << " darts of building_0 in " << snapshot_query << " s" << endl;
+}
+
+// Reconstructs a synthetic model in the given mode, then exports it if
+// exports is set. A streamed model is serialized first and its parsing is
+// part of the reconstruction time; the others are reconstructed from the
+// json tree.
+void run(Synthetic_layout layout, bool solids, size_t object_count, const Bench_mode& mode, bool exports)
+{
+  Synthetic_cityjson generator(layout, solids);
+  nlohmann::json city_model = generator.generate(object_count);
+  string text;
+  if (mode.stream)
+  {
+    text = city_model.dump();
+    city_model = nlohmann::json();
+  }
+
+  CityJsonReader reader;
+  reader.setIntegerMatching(mode.integer_matching);
+  if (mode.threads >= 0)
+  {
+    reader.setThreadCount(static_cast<unsigned int>(mode.threads));
+  }
+  reader.setTileSize(mode.tile_size);
+
+  // What the by-value traversal of the old reader allocated on this model
+  uint64_t allocations = allocation_count;
+  if (!mode.stream)
+  {
+    Old_parse_chain old_chain;
+    old_chain.read(city_model);
+  }
+  double old_allocations = static_cast<double>(allocation_count - allocations) / object_count;
+
+  allocations = allocation_count;
+  Clock::time_point start = Clock::now();
+  const LCC& lcc = mode.stream ? reader.readCityModel(text.data(), text.size()) : reader.readCityModel(city_model);
+  double reconstruct = seconds_since(start);
+  allocations = allocation_count - allocations;
+
+  double darts = static_cast<double>(lcc.number_of_darts());
+  cout << synthetic_layout_name(layout) << (solids ? " Solid" : " MultiSurface")
+       << ", " << object_count << " objects, " << mode.name << ", " << lcc.number_of_darts() << " darts" << endl
+       << "  reconstruct: " << reconstruct << " s, " << object_count / reconstruct << " objects/s, "
+       << darts / reconstruct << " darts/s" << endl
+       << "  allocations: " << static_cast<double>(allocations) / object_count << " per object";
+  if (!mode.stream)
+  {
+    cout << ", the copies of the old by-value parse chain made " << old_allocations << " per object";
+  }
+  cout << endl;
+
+  if (exports)
+  {
+    run_exports(lcc);
+  }
+
+  cout << "  peak RSS: " << peak_rss_mb() << " MB" << endl;
+}
+
+// Runs a configuration in a child process and waits for it
+void run_child(Synthetic_layout layout, bool solids, size_t object_count, const Bench_mode& mode, bool exports)
+{
+  cout.flush();
+  pid_t child = fork();
+  if (child == 0)
+  {
+    run(layout, solids, object_count, mode, exports);
+    cout.flush();
+    _exit(0);
+  }
+
+  int status = 0;
+  if (child < 0 || waitpid(child, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+  {
+    cerr << "Configuration " << synthetic_layout_name(layout) << " " << mode.name << " failed" << endl;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  vector<size_t> sizes;
+  for (int i = 1; i < argc; i++)
+  {
+    sizes.push_back(static_cast<size_t>(atol(argv[i])));
+  }
+  if (sizes.empty())
+  {
+    sizes.push_back(1000);
+    sizes.push_back(10000);
+  }
+
+  const Synthetic_layout layouts[] = {LAYOUT_GRID, LAYOUT_TERRACED, LAYOUT_PRISMS};
+  for (size_t object_count : sizes)
+  {
+    for (Synthetic_layout layout : layouts)
+    {
+      for (bool solids : {true, false})
+      {
+        for (const Bench_mode& mode : bench_modes)
+        {
+          // The exports do not depend on the mode
+          run_child(layout, solids, object_count, mode, &mode == &bench_modes[0]);
+        }
+      }
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,107 @@
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "../typedefs.h"
+#include "../cityjson_reader.h"
+#include "../cityjson_writer.h"
+#include "../darts_writer.h"
+#include "../mesh_writer.h"
+#include "../lcc_binary.h"
+#include "../lcc_statistics.h"
+#include "../mapped_file.h"
+#include "synthetic_cityjson.h"
+
+using namespace std;
+
+// Checks that no whole complex is copied by what the tool runs for
+// -o -off -ply -b -n --validate: the reconstruction, every export and the
+// statistics, on a loaded and on a streamed model. The face and volume infos
+// count their copies, so a copy of the complex shows as a count that grows
+// with the model.
+//
+// Usage: cityjson2lcc_copy_check; exits with 1 if the complex is copied
+
+uint64_t info_copy_count()
+{
+  return Info_copy_counter<Face_info>::copies() + Info_copy_counter<Volume_info>::copies();
+}
+
+// The exports and statistics of main, in the same order, to scratch files
+void run_exports(const LCC& lcc, const Run_stats& stats)
+{
+  save_combinatorial_map(lcc, "copy_check.3map");
+  {
+    ofstream off_file("copy_check.off");
+    write_mesh_off(off_file, lcc);
+  }
+  {
+    ofstream ply_file("copy_check.ply", ios::binary);
+    write_mesh_ply(ply_file, lcc);
+  }
+  save_lcc_binary(lcc, "copy_check.lccb");
+
+  nlohmann::json statistics = lcc_statistics(lcc, stats);
+  statistics["validation"] = lcc_validation(lcc);
+  ostringstream summary;
+  print_statistics(statistics, summary);
+
+  remove("copy_check.3map");
+  remove("copy_check.off");
+  remove("copy_check.ply");
+  remove("copy_check.lccb");
+}
+
+// Info copies made on a model of object_count objects, loaded in memory or
+// streamed from a file
+uint64_t info_copies(size_t object_count, bool stream)
+{
+  Synthetic_cityjson generator(LAYOUT_TERRACED, true);
+  nlohmann::json city_model = generator.generate(object_count);
+  if (stream)
+  {
+    ofstream input_file("copy_check.json");
+    input_file << city_model;
+    city_model = nlohmann::json();
+  }
+
+  uint64_t copies = info_copy_count();
+  {
+    Mapped_file input_file("copy_check.json");
+    CityJsonReader reader;
+    const LCC& lcc = stream ? reader.readCityModel(input_file.data(), input_file.size()) : reader.readCityModel(city_model);
+
+    ostringstream output;
+    if (stream)
+    {
+      copy_cityjson_with_darts(input_file, output, lcc);
+    }
+    else
+    {
+      write_cityjson_with_darts(output, city_model, lcc);
+    }
+    run_exports(lcc, reader.getStats());
+  }
+  copies = info_copy_count() - copies;
+
+  remove("copy_check.json");
+  return copies;
+}
+
+int main()
+{
+  bool ok = true;
+  for (bool stream : {false, true})
+  {
+    uint64_t small = info_copies(100, stream), large = info_copies(1000, stream);
+    bool same = small == large;
+    cout << (stream ? "streamed" : "loaded") << " model: " << small << " info copies for 100 objects, "
+         << large << " for 1000 objects: " << (same ? "ok" : "FAILED, the complex is copied") << endl;
+    ok = ok && same;
+  }
+
+  return ok ? 0 : 1;
+}
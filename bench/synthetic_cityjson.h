@@ -0,0 +1,150 @@
+#ifndef SYNTHETIC_CITYJSON_H
+#define SYNTHETIC_CITYJSON_H
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../thirdparty/json.hpp"
+
+// Generators of synthetic CityJSON city models for the benchmarks. Models
+// are transformed with a millimetre scale, so vertices are integers, and a
+// corner shared by several buildings is a single vertex, as in real files.
+enum Synthetic_layout
+{
+  LAYOUT_GRID,     // LoD1 boxes on a grid, apart from each other
+  LAYOUT_TERRACED, // LoD1 boxes in rows, neighbours sharing a wall
+  LAYOUT_PRISMS    // LoD2 prisms with a many-vertex footprint and roof
+};
+
+inline const char* synthetic_layout_name(Synthetic_layout layout)
+{
+  switch (layout)
+  {
+  case LAYOUT_TERRACED:
+    return "terraced";
+  case LAYOUT_PRISMS:
+    return "prisms";
+  default:
+    return "grid";
+  }
+}
+
+class Synthetic_cityjson
+{
+public:
+  // sides is the number of vertices of the footprints of LAYOUT_PRISMS
+  Synthetic_cityjson(Synthetic_layout layout, bool solids, int sides = 32) :
+    m_layout(layout), m_solids(solids), m_sides(sides)
+  {}
+
+  nlohmann::json generate(std::size_t object_count)
+  {
+    m_model = nlohmann::json::object();
+    m_model["type"] = "CityJSON";
+    m_model["version"] = "1.0";
+    m_model["transform"]["scale"] = {0.001, 0.001, 0.001};
+    m_model["transform"]["translate"] = {0.0, 0.0, 0.0};
+    m_model["CityObjects"] = nlohmann::json::object();
+    m_vertices = nlohmann::json::array();
+    m_vertex_ids.clear();
+
+    // Rows of 100 buildings, 10 m wide and 10 m apart unless terraced
+    const long size = 10000, gap = m_layout == LAYOUT_TERRACED ? 0 : 10000;
+    for (std::size_t i = 0; i < object_count; i++)
+    {
+      long x = static_cast<long>(i % 100) * (size + gap);
+      long y = static_cast<long>(i / 100) * (size + 10000);
+      // Same height along a row, so terraced neighbours share whole walls
+      long height = 6000 + static_cast<long>(i / 100 % 7) * 1000;
+
+      std::vector<std::array<long, 2> > footprint;
+      if (m_layout == LAYOUT_PRISMS)
+      {
+        for (int k = 0; k < m_sides; k++)
+        {
+          double angle = 2 * M_PI * k / m_sides;
+          footprint.push_back({{x + size / 2 + std::lround(size / 2 * std::cos(angle)),
+                                y + size / 2 + std::lround(size / 2 * std::sin(angle))}});
+        }
+      }
+      else
+      {
+        footprint.push_back({{x, y}});
+        footprint.push_back({{x + size, y}});
+        footprint.push_back({{x + size, y + size}});
+        footprint.push_back({{x, y + size}});
+      }
+
+      add_prism("building_" + std::to_string(i), footprint, height);
+    }
+
+    m_model["vertices"] = std::move(m_vertices);
+    return std::move(m_model);
+  }
+
+private:
+  std::size_t vertex(long x, long y, long z)
+  {
+    std::array<long, 3> key = {{x, y, z}};
+    auto it = m_vertex_ids.find(key);
+    if (it != m_vertex_ids.end())
+    {
+      return it->second;
+    }
+
+    std::size_t id = m_vertices.size();
+    m_vertices.push_back({x, y, z});
+    m_vertex_ids[key] = id;
+    return id;
+  }
+
+  // Extrudes a counter-clockwise footprint, with all faces oriented outwards
+  void add_prism(const std::string& id, const std::vector<std::array<long, 2> >& footprint, long height)
+  {
+    const std::size_t n = footprint.size();
+    std::vector<std::size_t> bottom, top;
+    for (const auto& p : footprint)
+    {
+      bottom.push_back(vertex(p[0], p[1], 0));
+      top.push_back(vertex(p[0], p[1], height));
+    }
+
+    nlohmann::json shell = nlohmann::json::array();
+    shell.push_back({std::vector<std::size_t>(bottom.rbegin(), bottom.rend())});
+    shell.push_back({top});
+    for (std::size_t k = 0; k < n; k++)
+    {
+      std::size_t next = (k + 1) % n;
+      shell.push_back({{bottom[k], bottom[next], top[next], top[k]}});
+    }
+
+    nlohmann::json geometry;
+    geometry["lod"] = m_layout == LAYOUT_PRISMS ? 2 : 1;
+    if (m_solids)
+    {
+      geometry["type"] = "Solid";
+      geometry["boundaries"] = {shell};
+    }
+    else
+    {
+      geometry["type"] = "MultiSurface";
+      geometry["boundaries"] = shell;
+    }
+
+    nlohmann::json& object = m_model["CityObjects"][id];
+    object["type"] = "Building";
+    object["geometry"] = {geometry};
+  }
+
+  Synthetic_layout m_layout;
+  bool m_solids;
+  int m_sides;
+  nlohmann::json m_model, m_vertices;
+  std::map<std::array<long, 3>, std::size_t> m_vertex_ids;
+};
+
+#endif
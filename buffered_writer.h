@@ -0,0 +1,146 @@
+#ifndef BUFFERED_WRITER_H
+#define BUFFERED_WRITER_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+#include "thirdparty/json.hpp"
+
+// Buffered writer for the exporters. Numbers are formatted into the buffer
+// without going through the stream, and the buffer is flushed to the stream
+// whenever it fills up, so memory use does not depend on how much is written.
+class Buffered_writer
+{
+public:
+  explicit Buffered_writer(std::ostream& output) : m_output(output)
+  {
+    m_buffer.reserve(buffer_size);
+  }
+
+  ~Buffered_writer()
+  {
+    flush();
+  }
+
+  void flush()
+  {
+    m_output.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+    m_buffer.clear();
+  }
+
+  void put(char c)
+  {
+    m_buffer.push_back(c);
+    if (m_buffer.size() >= buffer_size)
+    {
+      flush();
+    }
+  }
+
+  void put(const char* s)
+  {
+    for (; *s != '\0'; s++)
+    {
+      put(*s);
+    }
+  }
+
+  void put_bytes(const void* data, std::size_t size)
+  {
+    m_buffer.append(static_cast<const char*>(data), size);
+    if (m_buffer.size() >= buffer_size)
+    {
+      flush();
+    }
+  }
+
+  void put_integer(int64_t value)
+  {
+    char digits[20];
+    int count = 0;
+
+    uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+    do
+    {
+      digits[count++] = static_cast<char>('0' + magnitude % 10);
+      magnitude /= 10;
+    } while (magnitude != 0);
+
+    if (value < 0)
+    {
+      put('-');
+    }
+    while (count > 0)
+    {
+      put(digits[--count]);
+    }
+  }
+
+  // Writes the shortest digits that read back as value, found with the
+  // Grisu2 implementation nlohmann::json uses for its own numbers (no
+  // printf and no round-trip check). Integral values, which transformed
+  // coordinates sometimes are, are written without a fraction.
+  void put_double(double value)
+  {
+    if (value > -9e15 && value < 9e15 && value == static_cast<double>(static_cast<int64_t>(value)))
+    {
+      put_integer(static_cast<int64_t>(value));
+      return;
+    }
+
+    char text[32];
+    if (!std::isfinite(value))
+    {
+      put(std::isnan(value) ? "nan" : value < 0 ? "-inf" : "inf");
+      return;
+    }
+    char* end = nlohmann::detail::to_chars(text, text + sizeof(text), value);
+    put_bytes(text, static_cast<std::size_t>(end - text));
+  }
+
+  // Writes s as a quoted and escaped JSON string
+  void put_json_string(const std::string& s)
+  {
+    static const char hex[] = "0123456789abcdef";
+
+    put('"');
+    for (unsigned char c : s)
+    {
+      if (c == '"' || c == '\\')
+      {
+        put('\\');
+        put(static_cast<char>(c));
+      }
+      else if (c < 0x20)
+      {
+        put("\\u00");
+        put(hex[c >> 4]);
+        put(hex[c & 0xf]);
+      }
+      else
+      {
+        put(static_cast<char>(c));
+      }
+    }
+    put('"');
+  }
+
+  static bool host_is_little_endian()
+  {
+    const uint16_t one = 1;
+    unsigned char first;
+    std::memcpy(&first, &one, 1);
+    return first == 1;
+  }
+
+private:
+  static const std::size_t buffer_size = 1 << 16;
+
+  std::ostream& m_output;
+  std::string m_buffer;
+};
+
+#endif
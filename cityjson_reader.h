@@ -2,62 +2,213 @@
 #include <fstream>
 #include <map>
 #include <vector>
+#include <algorithm>
+#include <cmath>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <thread>
 
 #include "typedefs.h"
+#include "vertex_key.h"
+#include "flat_hash_map.h"
+#include "face_signature.h"
+#include "cityjson_sax.h"
+#include "vertex_buffer.h"
+#include "lcc_append.h"
+#include "reader_log.h"
+#include "run_stats.h"
 
 using namespace std;
 
 class CityJsonReader
 {
 private:
+  // Half-edge waiting in the 1-cell index for its twin to be 2-sewn with
+  struct Half_edge
+  {
+    Dart_handle dart;
+    uint32_t from;
+  };
+
+  typedef Flat_hash_map<uint64_t, Half_edge, Vertex_id_hash> Edge_index;
+  typedef Flat_hash_map<Face_key, Dart_handle, Face_key_hash> Face_index;
+
+  // Free darts of a vertex in the 0-cell index, kept as a list of nodes in
+  // dart_nodes so that indexing a dart does not allocate
+  struct Dart_node
+  {
+    Dart_handle dart;
+    uint32_t next;
+  };
+
+  struct Dart_list
+  {
+    uint32_t first, last;
+  };
+
+  static const uint32_t no_dart_node = 0xffffffffu;
+
+  // City object queued for the parallel mode, with the tile it falls in
+  // when tiles are used. Objects of a document in memory are referred to,
+  // streamed ones are moved into owned. Tiles need every object queued
+  // before the first one is reconstructed, so streaming with tiles ends up
+  // holding all the city objects in memory as json, as loading does.
+  struct Parallel_job
+  {
+    uint32_t object;
+    const nlohmann::json* obj;
+    nlohmann::json owned;
+    unsigned int index;
+    long long tile_x, tile_y;
+
+    const nlohmann::json& content() const
+    {
+      return obj != nullptr ? *obj : owned;
+    }
+  };
+
+  // Face of a worker still waiting in the 2-cell index for its other side
+  struct Open_face
+  {
+    Face_key signature;
+    Dart_handle dart;
+  };
+
   LCC lcc;
   nlohmann::json cityModel;
   unsigned int start_i = 0, object_limit = 0;
+  unsigned int object_i = 0;
+  size_t object_count = 0, geometry_count = 0;
   int precision = 3;
+  double precision_factor = 1000;
   string id_filter = "";
   int lod_filter = -1;
   bool index_1_per_object = false;
-  double scale[3] = {1, 1, 1};
-  double translate[3] = {0, 0, 0};
-
-  ostringstream log_str;
-  unordered_map<string, vector<Dart_handle> > index_0_cell;
-  unordered_map<string, Dart_handle> index_1_cell;
-  unordered_map<string, Dart_handle> index_2_cell;
-
-public:
-  Point json_to_point(nlohmann::json p)
+  bool integer_matching = false;
+  bool use_integer_keys = false;
+  unsigned int thread_count = 1;
+  bool parallel = false;
+  double tile_size = 0;
+  Vertex_buffer vertices;
+
+  Reader_log log_str;
+  Run_stats stats;
+  Flat_hash_map<Vertex_key, uint32_t, Vertex_key_hash> vertex_ids;
+  Flat_hash_map<uint32_t, Dart_list, Vertex_id_hash> index_0_cell;
+  vector<Dart_node> dart_nodes;
+  uint32_t free_dart_node = no_dart_node;
+  Edge_index index_1_cell;
+  Face_index index_2_cell;
+  Face_signature_pool index_2_ids;
+
+  // Scratch storage for the polygon being parsed and the face being 3-sewn,
+  // reused across polygons so that they keep their capacity
+  vector<unsigned long> polygon_indices;
+  vector<uint32_t> polygon_ids;
+  vector<Dart_handle> polygon_darts;
+  vector<uint32_t> ring;
+  Face_signature face_signature, inverse_signature;
+
+  // Parallel mode. Objects are queued in batches of a fixed size and split in
+  // chunks of a fixed size, so the result does not depend on thread_count.
+  // With tiles, all objects are queued and split by tile instead.
+  size_t parallel_batch_size = 4096, parallel_chunk_size = 16;
+  vector<Parallel_job> jobs;
+  vector<uint32_t> vertex_id_table;
+  unsigned int jobs_done = 0;
+
+  // Set on the workers of the parallel mode, which read the vertices of
+  // their parent and keep their open faces for the merge
+  const CityJsonReader* parent = nullptr;
+  vector<Open_face> open_faces;
+  vector<uint32_t> open_face_ids;
+
+  explicit CityJsonReader(const CityJsonReader* parent_reader) :
+    lod_filter(parent_reader->lod_filter),
+    index_1_per_object(parent_reader->index_1_per_object),
+    tile_size(parent_reader->tile_size),
+    parent(parent_reader)
   {
-    return Point((double)p[0] * scale[0] + translate[0], (double)p[1] * scale[1] + translate[1], (double)p[2] * scale[2] + translate[2]);
+    log_str.set_level(parent_reader->log_str.level());
   }
 
+public:
+  CityJsonReader()
+  {}
+
   double round_by(double f, int d)
   {
     double ex = pow(10, d);
     return round(f * ex) / ex;
   }
 
-  string get_point_name(Point p)
+  Vertex_key get_point_key(const Point& p)
   {
-    ostringstream st;
+    return make_vertex_key(p, precision, precision_factor);
+  }
 
-    st << fixed << setprecision(precision);
-    st << p.x() << "-" << p.y() << "-" << p.z();
+  // Key of a vertex of the city model. With integer matching on a transformed
+  // file this is the stored integer triple, so no floating point is involved.
+  Vertex_key get_vertex_key(unsigned long i)
+  {
+    if (use_integer_keys)
+    {
+      return vertex_buffer().integer_key(i);
+    }
 
-    //st << round_by(p.x(), precision) << "-" << round_by(p.y(), precision) << "-" << round_by(p.z(), precision);
+    return get_point_key(vertex_buffer().point(i));
+  }
+
+  // Dense id of a vertex key, shared by all vertices that match it
+  uint32_t get_vertex_id(const Vertex_key& key)
+  {
+    uint32_t next_id = static_cast<uint32_t>(vertex_ids.size());
+    return vertex_ids.find_or_insert(key, next_id).first->value;
+  }
+
+  // Dense id of vertex i of the city model. Workers read it from the table
+  // their parent filled before the objects were queued.
+  uint32_t get_vertex_id(unsigned long i)
+  {
+    if (parent != nullptr)
+    {
+      return parent->vertex_id_table[i];
+    }
+
+    return get_vertex_id(get_vertex_key(i));
+  }
 
-    return st.str();
+  Point get_vertex_point(unsigned long i)
+  {
+    return vertex_buffer().point(i);
   }
 
-  string index_to_string(unordered_map<string, Dart_handle>::iterator it)
+  const Vertex_buffer& vertex_buffer() const
+  {
+    return parent != nullptr ? parent->vertices : vertices;
+  }
+
+  string half_edge_name(uint64_t key, const Half_edge& half_edge)
   {
     ostringstream str;
 
-    str << it->first << ": ";
-    if (it->second == nullptr)
+    uint32_t low = static_cast<uint32_t>(key >> 32);
+    uint32_t high = static_cast<uint32_t>(key);
+    str << half_edge.from << "-" << (half_edge.from == low ? high : low);
+
+    return str.str();
+  }
+
+  string index_to_string(const Edge_index::Entry& entry)
+  {
+    ostringstream str;
+
+    str << half_edge_name(entry.key, entry.value) << ": ";
+    if (entry.value.dart == nullptr)
       str << "IS NULL" << endl;
     else
-      str << lcc.point(it->second) << endl;
+      str << lcc.point(entry.value.dart) << endl;
 
     return str.str();
   }
@@ -65,278 +216,700 @@ public:
   void show_null_index_records()
   {
 #ifdef DEBUG
-    for( unordered_map<string, Dart_handle>::iterator it = index_1_cell.begin(); it != index_1_cell.end(); it++)
+    index_1_cell.for_each([this](const Edge_index::Entry& entry)
     {
-      if (it->second == NULL)
+      if (entry.value.dart == NULL)
       {
-        log_str << "NOW " << it->first << " IS NULL!!!!!" << endl;
+        READER_LOG(log_str, LOG_DEBUG, "NOW " << half_edge_name(entry.key, entry.value) << " IS NULL!!!!!" << endl);
       }
-    }
+    });
 #endif // DEBUG
   }
 
-  template <class T>
-  string get_edge_name(T v1, T v2)
-  {
-    return get_point_name(v1) + "-" + get_point_name(v2);
-  }
-
-  void get_polygon_name(vector<Dart_handle> darts, string &name, Dart_handle &lowest_dart, bool step_forward)
-  {
-    string lowest_name = get_point_name(lcc.point(darts.front()));
-    lowest_dart = darts.front();
-    for( vector<Dart_handle>::iterator it = darts.begin(); it != darts.end(); ++it)
-    {
-      string new_point = get_point_name(lcc.point(*darts.begin()));
-      if (new_point < lowest_name)
-      {
-        lowest_name = new_point;
-        lowest_dart = *it;
-      }
-    }
-
-    int beta_i = step_forward ? 1 : 0;
-    name = lowest_name;
-    Dart_handle next = lcc.beta(lowest_dart, beta_i);
-    while (next != lowest_dart && next != lcc.null_dart_handle)
-    {
-      name += "-" + get_point_name(lcc.point(next));
-      next = lcc.beta(next, beta_i);
-    }
-  }
-
-  Dart_handle add_vertex(Point v, int i_free = -1)
+  Dart_handle add_vertex(unsigned long v, uint32_t v_id, int i_free = -1)
   {
-    Dart_handle result;
-    bool found = false;
-    string v_name = get_point_name(v);
-    if (index_0_cell.find(v_name) != index_0_cell.end())
+    stats.count(COUNT_INDEX_0_LOOKUPS);
+    auto cell = index_0_cell.find(v_id);
+    if (cell != nullptr)
     {
-      for (vector<Dart_handle>::iterator it = index_0_cell[v_name].begin(); it != index_0_cell[v_name].end(); ++it)
+      Dart_list& darts = cell->value;
+      for (uint32_t prev = no_dart_node, n = darts.first; n != no_dart_node; prev = n, n = dart_nodes[n].next)
       {
-        if (i_free < 0 || lcc.beta(*it, i_free) == lcc.null_dart_handle)
+        Dart_handle result = dart_nodes[n].dart;
+        if (i_free < 0 || lcc.beta(result, i_free) == lcc.null_dart_handle)
         {
-          found = true;
-          result = *it;
+          uint32_t next = dart_nodes[n].next;
+          if (prev == no_dart_node) {
+            darts.first = next;
+          } else {
+            dart_nodes[prev].next = next;
+          }
+          if (darts.last == n) {
+            darts.last = prev;
+          }
 
-          index_0_cell[v_name].erase(it);
-          if (index_0_cell[v_name].empty())
+          dart_nodes[n].next = free_dart_node;
+          free_dart_node = n;
+          if (darts.first == no_dart_node)
           {
-            index_0_cell.erase(v_name);
+            index_0_cell.erase(cell);
           }
 
-          break;
+          return result;
         }
       }
     }
 
-    if( !found )
+    Dart_handle result = lcc.create_dart( get_vertex_point(v) );
+    stats.count(COUNT_DARTS);
+
+    uint32_t n = free_dart_node;
+    if (n != no_dart_node) {
+      free_dart_node = dart_nodes[n].next;
+    } else {
+      n = static_cast<uint32_t>(dart_nodes.size());
+      dart_nodes.push_back(Dart_node());
+    }
+    dart_nodes[n].dart = result;
+    dart_nodes[n].next = no_dart_node;
+
+    Dart_list darts = {n, n};
+    auto cell_entry = index_0_cell.find_or_insert(v_id, darts);
+    if (!cell_entry.second)
     {
-      result = lcc.create_dart( v );
-      index_0_cell[v_name].push_back(result);
-      // log_str << "Created " << lcc.point(result) << endl;
+      dart_nodes[cell_entry.first->value.last].next = n;
+      cell_entry.first->value.last = n;
     }
+    // log_str << "Created " << lcc.point(result) << endl;
 
     return result;
   }
 
-  Dart_handle add_edge(Point v1, Point v2)
+  Dart_handle add_edge(unsigned long v1, uint32_t id1, unsigned long v2, uint32_t id2)
   {
     Dart_handle result;
 
-    result = add_vertex(v1, 1);
-    Dart_handle temp_dart = add_vertex(v2, 0);
+    result = add_vertex(v1, id1, 1);
+    Dart_handle temp_dart = add_vertex(v2, id2, 0);
 
     lcc.sew<1>(result, temp_dart);
+    stats.count(COUNT_SEW_1);
+
+    // Both half-edges share the slot: either we find the twin waiting there
+    // or this half-edge takes its place.
+    Half_edge half_edge = {result, id1};
+    stats.count(COUNT_INDEX_1_LOOKUPS);
+    auto slot = index_1_cell.find_or_insert(make_edge_key(id1, id2), half_edge);
+    if (!slot.second)
+    {
+      if (slot.first->value.from == id1)
+      {
+        slot.first->value = half_edge;
+      }
+      else
+      {
+        sew_2(result, slot.first->value.dart);
 
-    string edge_v1_v2_name = get_edge_name(v1, v2);
-    string edge_v2_v1_name = get_edge_name(v2, v1);
+        index_1_cell.erase(slot.first);
+      }
+    }
 
-    index_1_cell[edge_v1_v2_name] = result;
+    show_null_index_records();
+
+    return result;
+  }
 
-    if (index_1_cell.find(edge_v2_v1_name) != index_1_cell.end())
+  // Whether linking a, which is i-free, with b by beta i closes the chain of
+  // darts that beta 2 and 3 link around their edge into a ring, instead of
+  // merging two edges into one
+  bool closes_edge_ring(Dart_handle a, Dart_handle b, unsigned int i)
+  {
+    unsigned int dim = 5 - i;
+    Dart_handle end = a;
+    while (!lcc.is_free(end, dim))
     {
-      lcc.sew<2>(result, index_1_cell[edge_v2_v1_name]);
+      end = lcc.beta(end, dim);
+      dim = 5 - dim;
+    }
 
-      index_1_cell.erase(edge_v1_v2_name);
-      index_1_cell.erase(edge_v2_v1_name);
+    return end == b && dim == i;
+  }
+
+  // 2-sews a with b and counts it for the statistics
+  void sew_2(Dart_handle a, Dart_handle b)
+  {
+    if (closes_edge_ring(a, b, 2))
+    {
+      stats.count(COUNT_EDGE_RINGS);
     }
+    lcc.sew<2>(a, b);
+    stats.count(COUNT_SEW_2);
+  }
 
-    show_null_index_records();
+  // 3-sews the face of a with the one of b, a with b and so on, and counts
+  // each pair of darts for the statistics
+  void sew_3(Dart_handle a, Dart_handle b)
+  {
+    Dart_handle x = a, y = b;
+    do
+    {
+      if (closes_edge_ring(x, y, 3))
+      {
+        stats.count(COUNT_EDGE_RINGS);
+      }
+      stats.count(COUNT_SEW_3);
+      x = lcc.beta<1>(x);
+      y = lcc.beta<0>(y);
+    } while (x != a);
 
-    return result;
+    lcc.sew<3>(a, b);
+  }
+
+  // Whether darts form one face, in order, as 3-sewing expects. This fails
+  // only when the 0-cell index handed out a dart left over by a degenerate
+  // polygon.
+  bool is_closed_ring(const vector<Dart_handle>& darts)
+  {
+    for (size_t i = 0; i < darts.size(); i++)
+    {
+      if (lcc.beta<1>(darts[i]) != darts[(i + 1) % darts.size()])
+      {
+        return false;
+      }
+    }
+
+    return true;
   }
 
-  vector<Point> parse_vertices(nlohmann::json vertices)
+  void parse_vertices(const nlohmann::json& ring_vertices, vector<unsigned long>& indices, vector<uint32_t>& ids)
   {
-    vector<Point> verts;
-    for (int i : vertices)
+    indices.reserve(ring_vertices.size());
+    ids.reserve(ring_vertices.size());
+    for (unsigned long i : ring_vertices)
     {
-      verts.push_back(json_to_point(cityModel["vertices"][i]));
+      if (i >= vertex_buffer().size())
+      {
+        throw out_of_range("Vertex index " + to_string(i) + " is out of range");
+      }
+
+      indices.push_back(i);
+      ids.push_back(get_vertex_id(i));
     }
+  }
 
-    return verts;
+  // Member key of obj, or null when obj has no such member. The parse_*
+  // functions only read the document through const references, so a missing
+  // member cannot be inserted as operator[] would do.
+  static const nlohmann::json& member(const nlohmann::json& obj, const char* key)
+  {
+    static const nlohmann::json missing;
+
+    auto it = obj.find(key);
+    return it != obj.end() ? *it : missing;
   }
 
-  vector<Dart_handle> parse_polygon(nlohmann::json poly, int level = 1)
+  // Returns the darts of the polygon, valid until the next polygon is parsed
+  const vector<Dart_handle>& parse_polygon(const nlohmann::json& poly, int level = 1)
   {
-    vector<Dart_handle> result;
+    vector<Dart_handle>& result = polygon_darts;
+    vector<unsigned long>& indices = polygon_indices;
+    vector<uint32_t>& ids = polygon_ids;
+    result.clear();
+    indices.clear();
+    ids.clear();
+    stats.count(COUNT_POLYGONS);
 
-    log_str << "+" << string(level * 2 - 2, '-') << " Polygon" << endl;
+    READER_LOG(log_str, LOG_DEBUG, "+" << string(level * 2 - 2, '-') << " Polygon" << endl);
 
     // TODO: Add support for holes
-    const vector<Point> verts = parse_vertices(poly[0]);
+    if (!poly.empty())
+    {
+      parse_vertices(poly[0], indices, ids);
+    }
 
-    auto id = poly[0].begin();
-    if (verts.size() > 2)
+    ring.clear();
+    if (ids.size() > 2)
     {
-      for(auto it = verts.begin(); (it + 1) != verts.end(); it++, id++)
+      for(size_t i = 0; i + 1 < ids.size(); i++)
       {
-        if (get_point_name(*it) != get_point_name(*(it + 1)))
+        if (ids[i] != ids[i + 1])
         {
-          Dart_handle new_dart = add_edge(*it, *(it + 1));
-          lcc.info<0>(new_dart).set_vertex(*id);
+          Dart_handle new_dart = add_edge(indices[i], ids[i], indices[i + 1], ids[i + 1]);
+          lcc.info<0>(new_dart).set_vertex(indices[i]);
           result.push_back(new_dart);
+          ring.push_back(ids[i]);
         }
       }
 
-      if (get_point_name(verts.back()) != get_point_name(*verts.begin()))
+      if (ids.back() != ids.front())
       {
-        Dart_handle new_dart = add_edge(verts.back(), *verts.begin());
-        lcc.info<0>(new_dart).set_vertex(*id);
+        Dart_handle new_dart = add_edge(indices.back(), ids.back(), indices.front(), ids.front());
+        lcc.info<0>(new_dart).set_vertex(indices.back());
         result.push_back(new_dart);
+        ring.push_back(ids.back());
       }
 
-      if (result.size() > 2)
+      if (result.size() > 2 && is_closed_ring(result))
       {
-        // Try to 3-sew with other polygons
-        string new_name;
-        Dart_handle new_dart;
-        get_polygon_name(result, new_name, new_dart, true);
-
-        string inverse_name;
-        get_polygon_name(result, inverse_name, new_dart, false);
-
-        if (index_2_cell.find(inverse_name) != index_2_cell.end())
+        // Try to 3-sew with other polygons: the other side of this face was
+        // indexed with the same ring walked in the opposite direction.
+        size_t new_start = make_face_signature(ring, false, face_signature);
+        size_t inverse_start = make_face_signature(ring, true, inverse_signature);
+
+        stats.count(COUNT_INDEX_2_LOOKUPS);
+        auto other = index_2_cell.find(Face_key(inverse_signature));
+        if (other != nullptr)
         {
-          Dart_handle other_dart = lcc.beta<0>(index_2_cell[inverse_name]);
-          log_str << "3-Sewing " << new_name << " with " << inverse_name << endl;
-          lcc.sew<3>(new_dart, other_dart);
+          Dart_handle other_dart = lcc.beta<0>(other->value);
+          READER_LOG(log_str, LOG_DEBUG, "3-Sewing " << face_signature << " with " << inverse_signature << endl);
+          sew_3(result[inverse_start], other_dart);
 
-          index_2_cell.erase(inverse_name);
+          unindex_face(other);
         }
         else
         {
-          index_2_cell[new_name] = new_dart;
+          index_face(face_signature, result[new_start]);
+          if (parent != nullptr)
+          {
+            Open_face face = {Face_key(face_signature), result[new_start]};
+            face.signature.pool = &open_face_ids;
+            face.signature.offset = static_cast<uint32_t>(open_face_ids.size());
+            open_face_ids.insert(open_face_ids.end(), face_signature.ids.begin(), face_signature.ids.end());
+            open_faces.push_back(face);
+          }
         }
       }
     }
     else
     {
-      log_str << "Ignoring this polygon because only 2 individual lines where found." << endl;
+      READER_LOG(log_str, LOG_DEBUG, "Ignoring this polygon because only 2 individual lines where found." << endl);
     }
 
-    log_str << "Now we have " << lcc.number_of_darts() << " darts!" << endl << endl;
+    READER_LOG(log_str, LOG_DEBUG, "Now we have " << lcc.number_of_darts() << " darts!" << endl << endl);
 
     return result;
   }
 
-  vector<Dart_handle> parse_shell(nlohmann::json solid, bool has_semantics, nlohmann::json::iterator semantic_id, int level)
+  // Sets the face and volume attributes of the darts of a polygon. They
+  // share one face unless the polygon was degenerate, so this is usually a
+  // single write.
+  void init_polygon(const vector<Dart_handle>& darts, const Face_record& face)
   {
-    vector<Dart_handle> result;
-
-    for (auto& polygon : solid)
+    LCC::Attribute_handle<2>::type last_face = LCC::null_handle;
+    for (Dart_handle dart : darts)
     {
-      auto temp_darts = parse_polygon( polygon, level + 1 );
-      result.insert(result.end(), temp_darts.begin(), temp_darts.end());
+      if (lcc.attribute<2>(dart) != LCC::null_handle && lcc.attribute<2>(dart) == last_face)
+      {
+        continue;
+      }
 
-      for (auto temp_dart: temp_darts)
+      init_face(dart);
+      Face_record record = face;
+      if (record.semantic_surface_id < 0)
       {
-        init_face(temp_dart);
-        if (has_semantics)
-        {
-          lcc.info<2>(temp_dart).set_semantic_surface_id(*semantic_id);
-        }
+        record.semantic_surface_id = lcc.info<2>(dart).get_semantic_surface_id();
       }
+      lcc.info<2>(dart).set_record(record);
+      last_face = lcc.attribute<2>(dart);
+
+      init_volume(dart);
+      lcc.info<3>(dart).set_object_index(face.object);
+    }
+  }
+
+  // face holds the object and geometry of the polygons of solid
+  void parse_shell(const nlohmann::json& solid, bool has_semantics, nlohmann::json::const_iterator semantic_id, Face_record face, int level)
+  {
+    for (auto& polygon : solid)
+    {
+      const vector<Dart_handle>& temp_darts = parse_polygon( polygon, level + 1 );
+
+      face.semantic_surface_id = -1;
       if (has_semantics)
       {
+        face.semantic_surface_id = *semantic_id;
         semantic_id++;
       }
+      init_polygon(temp_darts, face);
     }
-
-    return result;
   }
 
-  vector<Dart_handle> parse_geometry(nlohmann::json geom, int level = 1)
+  void parse_geometry(const nlohmann::json& geom, const Face_record& face, int level = 1)
   {
-    vector<Dart_handle> result;
+    const nlohmann::json& type = member(geom, "type");
+    const nlohmann::json& boundaries = member(geom, "boundaries");
 
-    log_str << string(level * 2 - 1, '-') << " Geometry (" << geom["type"] << ")" << endl;
+    READER_LOG(log_str, LOG_DEBUG, string(level * 2 - 1, '-') << " Geometry (" << type << ")" << endl);
 
-    if (lod_filter > 0 && geom.find("lod") != geom.end() && geom["lod"] != lod_filter)
+    const nlohmann::json& lod = member(geom, "lod");
+    if (lod_filter > 0 && !lod.is_null() && lod != lod_filter)
     {
-      log_str << "Skipping LoD " << geom["lod"] << " because of LoD" << lod_filter << " filter!" << endl;
-      return result;
+      READER_LOG(log_str, LOG_DEBUG, "Skipping LoD " << lod << " because of LoD" << lod_filter << " filter!" << endl);
+      return;
     }
 
     bool has_semantics = geom.find("semantics") != geom.end();
-    nlohmann::json::iterator semantic_id;
+    nlohmann::json::const_iterator semantic_id;
     if (has_semantics)
     {
-      semantic_id = geom["semantics"]["values"].begin();
+      semantic_id = member(member(geom, "semantics"), "values").begin();
     }
 
-    if (geom["type"] == "Solid")
+    if (type == "Solid")
     {
-      log_str << "|" << string(level * 2 - 1, '-') << " Solid count: " << geom["boundaries"].size() << endl;
-      for (auto& shell : geom["boundaries"])
+      READER_LOG(log_str, LOG_DEBUG, "|" << string(level * 2 - 1, '-') << " Solid count: " << boundaries.size() << endl);
+      for (auto& shell : boundaries)
       {
-        nlohmann::json::iterator semantic_list;
+        nlohmann::json::const_iterator semantic_list;
         if (has_semantics)
         {
           semantic_list = (*semantic_id).begin();
         }
-        auto temp_darts = parse_shell(shell, has_semantics, semantic_list, level);
-        result.insert(result.end(), temp_darts.begin(), temp_darts.end());
+        parse_shell(shell, has_semantics, semantic_list, face, level);
       }
     }
-    else if (geom["type"] == "MultiSurface" || geom["type"] == "CompositeSurface")
+    else if (type == "MultiSurface" || type == "CompositeSurface")
     {
-      log_str << "|" << string(level * 2 - 1, '-') << " Polygon count: " << geom["boundaries"].size() << endl;
-      auto temp_darts = parse_shell(geom["boundaries"], has_semantics, semantic_id, level);
-      result.insert(result.end(), temp_darts.begin(), temp_darts.end());
+      READER_LOG(log_str, LOG_DEBUG, "|" << string(level * 2 - 1, '-') << " Polygon count: " << boundaries.size() << endl);
+      parse_shell(boundaries, has_semantics, semantic_id, face, level);
     }
+  }
 
-    return result;
+  // Reconstructs a city object; object is the index of its id in
+  // object_ids()
+  void parse_object(uint32_t object, const nlohmann::json& obj)
+  {
+    READER_LOG(log_str, LOG_DEBUG, "Object " << object_ids().id(object) << endl);
+    READER_LOG(log_str, LOG_DEBUG, "---------------------" << endl);
+
+    const nlohmann::json& geometry = member(obj, "geometry");
+
+    READER_LOG(log_str, LOG_DEBUG, "Type: " << member(obj, "type") << endl);
+    READER_LOG(log_str, LOG_DEBUG, "Geometry count: " << geometry.size() << endl);
+
+    stats.count(COUNT_OBJECTS);
+
+    Face_record face = {object, 0, -1};
+    for (auto& geom : geometry)
+    {
+      stats.count(COUNT_GEOMETRIES);
+      parse_geometry( geom, face );
+      face.geometry_id++;
+    }
+  }
+
+  // Indexes the face with the given signature in the 2-cell index, copying
+  // its ids to the pool unless the signature is already there
+  void index_face(const Face_signature& signature, Dart_handle dart)
+  {
+    auto entry = index_2_cell.find(Face_key(signature));
+    if (entry != nullptr)
+    {
+      entry->value = dart;
+      return;
+    }
+
+    index_2_cell.find_or_insert(index_2_ids.add(signature), dart);
+  }
+
+  void unindex_face(Face_index::Entry* entry)
+  {
+    index_2_ids.release(entry->key);
+    index_2_cell.erase(entry);
+    index_2_ids.compact(index_2_cell);
+  }
+
+  // Drops the faces recorded since first that were 3-sewn or replaced in the
+  // 2-cell index in the meantime. The ids of the kept ones are moved down
+  // with them, so open_face_ids only grows with the faces left open.
+  void keep_open_faces(size_t first)
+  {
+    size_t kept = first;
+    uint32_t ids_end = first < open_faces.size() ? open_faces[first].signature.offset : static_cast<uint32_t>(open_face_ids.size());
+    for (size_t i = first; i < open_faces.size(); i++)
+    {
+      auto entry = index_2_cell.find(open_faces[i].signature);
+      if (entry != nullptr && entry->value == open_faces[i].dart)
+      {
+        Open_face face = open_faces[i];
+        std::copy(face.signature.begin(), face.signature.end(), open_face_ids.begin() + ids_end);
+        face.signature.offset = ids_end;
+        ids_end += face.signature.size;
+        open_faces[kept++] = face;
+      }
+    }
+
+    open_faces.resize(kept);
+    open_face_ids.resize(ids_end);
   }
 
-  void parse_object(pair<const string, nlohmann::json> &obj)
+  // Worker side of the parallel mode: reconstructs one object on its own,
+  // with all the indexes cleared afterwards. The objects of a tile share
+  // their indexes instead, as in the sequential mode.
+  void reconstruct_object(Parallel_job& job)
   {
-    log_str << "Object " << obj.first << endl;
-    log_str << "---------------------" << endl;
+    size_t first_open_face = open_faces.size();
+
+    parse_object(job.object, job.content());
+
+    if (log_str.enabled(LOG_DEBUG))
+    {
+      log_str.stream() << job.index << ") ";
+#ifdef DEBUG
+      lcc.display_characteristics(log_str.stream());
+#endif
+      log_str.stream() << endl << endl;
+      log_str.written();
+    }
 
-    auto obj_content = obj.second;
+    if (tile_size > 0)
+    {
+      if (index_1_per_object) {
+        index_1_cell.clear();
+      }
+      return;
+    }
 
-    log_str << "Type: " << obj_content["type"] << endl;
-    log_str << "Geometry count: " << obj_content["geometry"].size() << endl;
+    keep_open_faces(first_open_face);
+    index_0_cell.clear();
+    dart_nodes.clear();
+    free_dart_node = no_dart_node;
+    index_1_cell.clear();
+    index_2_cell.clear();
+    index_2_ids.clear();
+  }
 
-    int g_id = 0;
-    for (auto& geom : obj_content["geometry"])
+  // 2-sews a half-edge of a worker, already copied to lcc, with its twin
+  // left unmatched by the tiles before it
+  void stitch_half_edge(uint64_t key, const Half_edge& half_edge)
+  {
+    stats.count(COUNT_INDEX_1_LOOKUPS);
+    auto slot = index_1_cell.find_or_insert(key, half_edge);
+    if (slot.second)
     {
-      vector<Dart_handle> darts = parse_geometry( geom );
+      return;
+    }
 
-      for (vector<Dart_handle>::iterator it = darts.begin(); it != darts.end(); ++it)
+    if (slot.first->value.from == half_edge.from)
+    {
+      slot.first->value = half_edge;
+    }
+    else if (lcc.is_sewable<2>(half_edge.dart, slot.first->value.dart))
+    {
+      READER_LOG(log_str, LOG_DEBUG, "Stitching " << half_edge_name(key, half_edge) << endl);
+      sew_2(half_edge.dart, slot.first->value.dart);
+
+      index_1_cell.erase(slot.first);
+    }
+    else
+    {
+      READER_LOG(log_str, LOG_DEBUG, "Cannot stitch " << half_edge_name(key, half_edge) << endl);
+    }
+  }
+
+  // Appends the complex of a worker to lcc and 3-sews its open faces with
+  // the ones left by the objects before it, as the sequential mode does
+  void merge_worker(CityJsonReader& worker)
+  {
+    Dart_copies copies;
+    append_lcc(lcc, worker.lcc, copies);
+    stats.add_counters(worker.stats);
+
+    READER_LOG(log_str, LOG_DEBUG, worker.log_str.str());
+    if (worker.log_str.truncated())
+    {
+      READER_LOG(log_str, LOG_DEBUG, "[log of this chunk truncated]" << endl);
+    }
+
+    worker.index_1_cell.for_each([this, &copies](const Edge_index::Entry& entry)
+    {
+      Half_edge half_edge = {copies.find(entry.value.dart)->value, entry.value.from};
+      stitch_half_edge(entry.key, half_edge);
+    });
+
+    for (Open_face& face : worker.open_faces)
+    {
+      Dart_handle dart = copies.find(face.dart)->value;
+      face_signature.ids.assign(face.signature.begin(), face.signature.end());
+      face_signature.hash = face.signature.hash;
+      size_t inverse_start = make_face_signature(face_signature.ids, true, inverse_signature);
+
+      stats.count(COUNT_INDEX_2_LOOKUPS);
+      auto other = index_2_cell.find(Face_key(inverse_signature));
+      if (other != nullptr)
       {
-        lcc.info<2>(*it).set_guid(obj.first);
-        lcc.info<2>(*it).set_geometry_id(g_id);
+        for (size_t k = 0; k < inverse_start; k++)
+        {
+          dart = lcc.beta<1>(dart);
+        }
+
+        READER_LOG(log_str, LOG_DEBUG, "3-Sewing " << face.signature << " with " << inverse_signature << endl);
+        sew_3(dart, lcc.beta<0>(other->value));
 
-        init_volume(*it);
-        lcc.info<3>(*it).set_guid(obj.first);
+        unindex_face(other);
+      }
+      else
+      {
+        index_face(face_signature, dart);
       }
-      g_id++;
     }
   }
 
+  // Splits the queued objects in chunks of consecutive objects
+  vector<size_t> chunk_bounds()
+  {
+    vector<size_t> bounds;
+    for (size_t j = 0; j < jobs.size(); j += parallel_chunk_size)
+    {
+      bounds.push_back(j);
+    }
+    bounds.push_back(jobs.size());
+
+    return bounds;
+  }
+
+  // Sorts the queued objects by tile, row by row, keeping the object order
+  // within a tile, and splits them in one chunk per tile
+  vector<size_t> tile_bounds()
+  {
+    stable_sort(jobs.begin(), jobs.end(), [](const Parallel_job& a, const Parallel_job& b)
+    {
+      return a.tile_y != b.tile_y ? a.tile_y < b.tile_y : a.tile_x < b.tile_x;
+    });
+
+    vector<size_t> bounds;
+    for (size_t j = 0; j < jobs.size(); j++)
+    {
+      if (j == 0 || jobs[j].tile_x != jobs[j - 1].tile_x || jobs[j].tile_y != jobs[j - 1].tile_y)
+      {
+        bounds.push_back(j);
+      }
+    }
+    bounds.push_back(jobs.size());
+
+    READER_LOG(log_str, LOG_INFO, "Reconstructing " << bounds.size() - 1 << " tiles of size " << tile_size << endl);
+
+    return bounds;
+  }
+
+  void add_to_bounds(const nlohmann::json& boundaries, double bounds[4])
+  {
+    if (boundaries.is_number())
+    {
+      unsigned long i = boundaries;
+      if (i < vertices.size())
+      {
+        Point p = vertices.point(i);
+        bounds[0] = min(bounds[0], p.x());
+        bounds[1] = min(bounds[1], p.y());
+        bounds[2] = max(bounds[2], p.x());
+        bounds[3] = max(bounds[3], p.y());
+      }
+      return;
+    }
+
+    for (auto& child : boundaries)
+    {
+      add_to_bounds(child, bounds);
+    }
+  }
+
+  // Tile of the centre of the 2D bounding box of a city object
+  void set_tile(Parallel_job& job)
+  {
+    double bounds[4] = {HUGE_VAL, HUGE_VAL, -HUGE_VAL, -HUGE_VAL};
+    for (auto& geom : member(job.content(), "geometry"))
+    {
+      add_to_bounds(member(geom, "boundaries"), bounds);
+    }
+
+    job.tile_x = 0;
+    job.tile_y = 0;
+    if (bounds[0] <= bounds[2])
+    {
+      job.tile_x = static_cast<long long>(floor((bounds[0] + bounds[2]) / 2 / tile_size));
+      job.tile_y = static_cast<long long>(floor((bounds[1] + bounds[3]) / 2 / tile_size));
+    }
+  }
+
+  // Whether objects are queued and reconstructed by workers, which is the
+  // case with a thread count or tiles
+  bool parallel_mode() const
+  {
+    return parallel || tile_size > 0;
+  }
+
+  // Reconstructs the queued objects chunk by chunk on thread_count threads,
+  // then merges the chunks in order. Chunk c holds the jobs from bounds[c]
+  // to bounds[c + 1]. The logs of the workers wait in memory for the merge,
+  // so each gets an even share of Reader_log::max_worker_bytes.
+  void run_jobs(const vector<size_t>& bounds)
+  {
+    size_t chunk_count = bounds.size() - 1;
+    size_t log_limit = max<size_t>(Reader_log::max_worker_bytes / max<size_t>(chunk_count, 1), 1);
+    vector<unique_ptr<CityJsonReader>> workers(chunk_count);
+    vector<exception_ptr> errors(chunk_count);
+    atomic<size_t> next_chunk(0);
+
+    auto work = [&]()
+    {
+      for (size_t c = next_chunk++; c < chunk_count; c = next_chunk++)
+      {
+        try
+        {
+          workers[c].reset(new CityJsonReader(this));
+          workers[c]->log_str.set_limit(log_limit);
+          for (size_t j = bounds[c]; j < bounds[c + 1]; j++)
+          {
+            workers[c]->reconstruct_object(jobs[j]);
+          }
+          workers[c]->keep_open_faces(0);
+        }
+        catch (...)
+        {
+          errors[c] = current_exception();
+        }
+      }
+    };
+
+    Run_stats::Clock::time_point start = Run_stats::Clock::now();
+    vector<thread> threads;
+    for (size_t t = 1; t < min<size_t>(thread_count, chunk_count); t++)
+    {
+      threads.push_back(thread(work));
+    }
+    work();
+    for (auto& t : threads)
+    {
+      t.join();
+    }
+    stats.add_time(PHASE_PARSE_OBJECTS, start);
+
+    start = Run_stats::Clock::now();
+    for (size_t c = 0; c < chunk_count; c++)
+    {
+      if (errors[c])
+      {
+        rethrow_exception(errors[c]);
+      }
+
+      merge_worker(*workers[c]);
+      workers[c].reset();
+
+      jobs_done += static_cast<unsigned int>(bounds[c + 1] - bounds[c]);
+      show_progress(jobs_done);
+    }
+    stats.add_time(PHASE_MERGE, start);
+
+    jobs.clear();
+  }
+
+  void show_progress(unsigned int done)
+  {
+    cout << "\rDone with " << done << "/" << object_limit;
+    cout.flush();
+  }
+
   void init_all_volumes()
   {
     for (LCC::One_dart_per_cell_range<3>::iterator
@@ -367,70 +940,233 @@ public:
     }
   }
 
-  LCC readCityModel(nlohmann::json city)
+  void begin_city_model()
   {
-    cityModel = city;
+    cout << "We found " << object_count << " root city objects!" << endl << endl;
 
-    if (cityModel.find("transform") != cityModel.end())
+    bool has_transform = cityModel.find("transform") != cityModel.end();
+    if (has_transform)
     {
+      double scale[3], translate[3];
       for (int d = 0; d < 3; d++)
       {
         scale[d] = cityModel["transform"]["scale"][d];
         translate[d] = cityModel["transform"]["translate"][d];
       }
+      vertices.set_transform(scale, translate);
     }
 
-    map<string, nlohmann::json> objs = city["CityObjects"];
-    int obj_count = objs.size();
+    Run_stats::Clock::time_point start = Run_stats::Clock::now();
+    vertices.build_points();
+    stats.add_time(PHASE_DECODE_VERTICES, start);
+    READER_LOG(log_str, LOG_INFO, "Transformed " << vertices.size() << " vertices (" << simd_level_name(best_simd_level()) << ")" << endl);
+
+    use_integer_keys = integer_matching && has_transform && vertices.is_integer();
+    if (integer_matching && !has_transform)
+    {
+      READER_LOG(log_str, LOG_INFO, "No transform in the city model, matching vertices with precision " << precision << " instead of integer coordinates." << endl);
+    }
+    else if (integer_matching && !vertices.is_integer())
+    {
+      READER_LOG(log_str, LOG_INFO, "Vertices are not all 32-bit integers, matching vertices with precision " << precision << " instead of integer coordinates." << endl);
+    }
+
+    if (parallel_mode())
+    {
+      // Objects are reconstructed independently, only their open faces are
+      // matched when they are merged. Tiles also leave their unmatched
+      // half-edges to be stitched.
+      if (tile_size <= 0)
+      {
+        index_1_per_object = true;
+      }
+      READER_LOG(log_str, LOG_INFO, "Reconstructing city objects on " << thread_count << " threads" << endl);
+
+      vertex_id_table.resize(vertices.size());
+      for (size_t i = 0; i < vertices.size(); i++)
+      {
+        vertex_id_table[i] = get_vertex_id(get_vertex_key(i));
+      }
+    }
 
     if (object_limit == 0)
     {
-      object_limit = obj_count;
+      object_limit = object_count;
     }
 
-    if (start_i + object_limit > objs.size())
+    if (start_i + object_limit > object_count)
     {
-      object_limit = obj_count - start_i;
+      object_limit = object_count - start_i;
     }
 
-    unsigned int i = 0;
-    for (auto& obj : objs)
+    object_i = 0;
+    jobs_done = 0;
+  }
+
+  // Processes one city object; returns false once the object limit is reached.
+  // If owned is set, obj is moved from it when it has to be kept for later,
+  // otherwise obj has to outlive the reconstruction.
+  bool read_object(const string& guid, const nlohmann::json& obj, nlohmann::json* owned = nullptr)
+  {
+    if (!id_filter.empty())
     {
-      if (!id_filter.empty())
+      size_t pos = guid.find(id_filter);
+      if (pos == string::npos)
       {
-        size_t pos = obj.first.find(id_filter);
-        if (pos == string::npos)
-        {
-          continue;
-        }
+        return true;
       }
+    }
 
-      parse_object(obj);
+    uint32_t object = object_ids().intern(guid);
+    if (parallel_mode())
+    {
+      Parallel_job job = {object, &obj, nlohmann::json(), object_i, 0, 0};
+      if (owned != nullptr)
+      {
+        job.obj = nullptr;
+        job.owned = std::move(*owned);
+      }
+      if (tile_size > 0)
+      {
+        set_tile(job);
+      }
+      jobs.push_back(std::move(job));
 
-      log_str << i << ") ";
+      if (tile_size <= 0 && jobs.size() == parallel_batch_size)
+      {
+        run_jobs(chunk_bounds());
+      }
+    }
+    else
+    {
+      Run_stats::Clock::time_point start = Run_stats::Clock::now();
+      parse_object(object, obj);
+      stats.add_time(PHASE_PARSE_OBJECTS, start);
+
+      if (log_str.enabled(LOG_DEBUG))
+      {
+        log_str.stream() << object_i << ") ";
 #ifdef DEBUG
-      lcc.display_characteristics(log_str);
+        lcc.display_characteristics(log_str.stream());
 #endif
-      log_str << endl << endl;
+        log_str.stream() << endl << endl;
+        log_str.written();
+      }
 
       if (index_1_per_object) {
         index_1_cell.clear();
       }
 
-      cout << "\rDone with " << i - start_i + 1 << "/" << object_limit;
-      cout.flush();
+      show_progress(object_i - start_i + 1);
+    }
 
-      i++;
-      if (i + 1 > object_limit)
-      {
-        break;
-      }
+    object_i++;
+    return object_i + 1 <= object_limit;
+  }
+
+  void end_city_model()
+  {
+    if (!jobs.empty())
+    {
+      run_jobs(tile_size > 0 ? tile_bounds() : chunk_bounds());
     }
 
     cout << endl;
 
+    Run_stats::Clock::time_point start = Run_stats::Clock::now();
     init_all_faces();
     init_all_volumes();
+    stats.add_time(PHASE_INIT_CELLS, start);
+
+    log_str.flush();
+  }
+
+  // The complex stays owned by the reader, which has to outlive the
+  // returned reference; it is never copied out
+  const LCC& readCityModel(const nlohmann::json& city)
+  {
+    // Only the transform is kept; the vertices are decoded once and the city
+    // objects are read in place
+    cityModel = nlohmann::json::object();
+    if (city.find("transform") != city.end())
+    {
+      cityModel["transform"] = city["transform"];
+    }
+
+    Run_stats::Clock::time_point start = Run_stats::Clock::now();
+    vertices.load(member(city, "vertices"));
+    stats.add_time(PHASE_DECODE_VERTICES, start);
+
+    const nlohmann::json& objs = member(city, "CityObjects");
+    object_count = objs.size();
+    geometry_count = 0;
+    for (auto& obj : objs)
+    {
+      geometry_count += member(obj, "geometry").size();
+    }
+
+    begin_city_model();
+
+    for (auto it = objs.begin(); it != objs.end(); ++it)
+    {
+      if (!read_object(it.key(), it.value()))
+      {
+        break;
+      }
+    }
+
+    end_city_model();
+
+    return lcc;
+  }
+
+  // Streaming variant: the document is never loaded as a whole. A first pass
+  // keeps only "transform" and "vertices", a second one builds and parses
+  // one city object at a time, in file order. input has to be seekable.
+  const LCC& readCityModel(istream& input)
+  {
+    return read_streamed([&input](Cityjson_sax& sax)
+    {
+      input.clear();
+      input.seekg(0);
+      nlohmann::json::sax_parse(input, &sax);
+    });
+  }
+
+  // Streaming variant reading from a buffer, such as a mapped file
+  const LCC& readCityModel(const char* data, size_t size)
+  {
+    return read_streamed([data, size](Cityjson_sax& sax)
+    {
+      nlohmann::json::sax_parse(data, data + size, &sax);
+    });
+  }
+
+  // Runs both passes of the streaming variants; parse runs sax over the
+  // whole document from its start
+  template <class Parse>
+  const LCC& read_streamed(Parse parse)
+  {
+    nlohmann::json header;
+    vertices.clear();
+    Cityjson_sax header_sax(header, vertices);
+    Run_stats::Clock::time_point start = Run_stats::Clock::now();
+    parse(header_sax);
+    stats.add_time(PHASE_DECODE_VERTICES, start);
+
+    cityModel = std::move(header);
+    object_count = header_sax.object_count();
+    geometry_count = header_sax.geometry_count();
+
+    begin_city_model();
+
+    Cityjson_sax object_sax([this](const string& guid, nlohmann::json& obj)
+    {
+      return read_object(guid, obj, &obj);
+    });
+    parse(object_sax);
+
+    end_city_model();
 
     return lcc;
   }
@@ -465,6 +1201,46 @@ public:
     lod_filter = lod;
   }
 
+  size_t getObjectCount()
+  {
+    return object_count;
+  }
+
+  size_t getGeometryCount()
+  {
+    return geometry_count;
+  }
+
+  // Log messages up to level are recorded; none by default
+  void setLogLevel(Log_level level)
+  {
+    log_str.set_level(level);
+  }
+
+  Log_level getLogLevel()
+  {
+    return log_str.level();
+  }
+
+  // Streams the log to output as it is written instead of keeping it for
+  // getLog(); output has to stay open until closeLog()
+  void setLogOutput(ostream& output)
+  {
+    log_str.stream_to(output);
+  }
+
+  void closeLog()
+  {
+    log_str.close();
+  }
+
+  // Timings and counters of the run, which the caller can add its own
+  // phases to
+  Run_stats& getStats()
+  {
+    return stats;
+  }
+
   string getLog()
   {
     return log_str.str();
@@ -475,15 +1251,15 @@ public:
     ostringstream str;
 
     str << "This is the final status of the 1-cell index" << endl << "--------" << endl;
-    for(unordered_map<string, Dart_handle>::iterator it=index_1_cell.begin(); it!=index_1_cell.end(); ++it)
+    index_1_cell.for_each([this, &str](const Edge_index::Entry& entry)
     {
-      str << index_to_string(it);
-    }
+      str << index_to_string(entry);
+    });
 
     return str.str();
   }
 
-  LCC getLinearCellComplex()
+  const LCC& getLinearCellComplex() const
   {
     return lcc;
   }
@@ -491,6 +1267,7 @@ public:
   void setPrecision(int new_precision)
   {
     precision = new_precision;
+    precision_factor = pow(10, precision);
   }
 
   int getPrecision()
@@ -507,4 +1284,45 @@ public:
   {
     return index_1_per_object;
   }
+
+  void setIntegerMatching(bool new_value)
+  {
+    integer_matching = new_value;
+  }
+
+  bool getIntegerMatching()
+  {
+    return integer_matching;
+  }
+
+  // Number of threads reconstructing city objects; 0 uses all cores. Once
+  // set, objects are reconstructed independently whatever the count, even 1,
+  // so that the complex does not depend on it.
+  void setThreadCount(unsigned int new_count)
+  {
+    thread_count = new_count > 0 ? new_count : max(1u, thread::hardware_concurrency());
+    parallel = true;
+  }
+
+  unsigned int getThreadCount()
+  {
+    return thread_count;
+  }
+
+  // Size of the square tiles reconstructed in parallel, in model units; 0
+  // disables tiles. Tiles use all cores unless setThreadCount() says
+  // otherwise.
+  void setTileSize(double new_size)
+  {
+    tile_size = new_size;
+    if (tile_size > 0 && !parallel)
+    {
+      thread_count = max(1u, thread::hardware_concurrency());
+    }
+  }
+
+  double getTileSize()
+  {
+    return tile_size;
+  }
 };
@@ -0,0 +1,281 @@
+#ifndef CITYJSON_SAX_H
+#define CITYJSON_SAX_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "thirdparty/json.hpp"
+#include "vertex_buffer.h"
+
+// SAX handler that reads a CityJSON document without building its DOM.
+//
+// In header mode it keeps the members the reader needs before any geometry
+// can be parsed: "transform" as json and "vertices" decoded straight into a
+// Vertex_buffer. It also counts the city objects and their geometries.
+// In objects mode it builds one member of "CityObjects" at a time and hands
+// it to a callback, which can stop the parse by returning false.
+class Cityjson_sax : public nlohmann::json_sax<nlohmann::json>
+{
+public:
+  typedef nlohmann::json json;
+  typedef std::function<bool(const std::string&, json&)> Object_callback;
+
+  // Header mode
+  Cityjson_sax(json& header, Vertex_buffer& vertices) :
+    m_header(&header), m_vertices(&vertices), m_object_count(0), m_geometry_count(0), m_depth(0), m_stopped(false)
+  {}
+
+  // Objects mode
+  explicit Cityjson_sax(Object_callback callback) :
+    m_header(nullptr), m_vertices(nullptr), m_callback(callback), m_object_count(0), m_geometry_count(0), m_depth(0), m_stopped(false)
+  {}
+
+  std::size_t object_count() const
+  {
+    return m_object_count;
+  }
+
+  std::size_t geometry_count() const
+  {
+    return m_geometry_count;
+  }
+
+  // Whether the callback ended the parse early, as opposed to a syntax error
+  bool stopped() const
+  {
+    return m_stopped;
+  }
+
+  bool null() override
+  {
+    return value(json(nullptr));
+  }
+
+  bool boolean(bool val) override
+  {
+    return value(json(val));
+  }
+
+  bool number_integer(number_integer_t val) override
+  {
+    if (in_vertices())
+    {
+      m_vertices->add(static_cast<int64_t>(val));
+      return true;
+    }
+
+    return value(json(val));
+  }
+
+  bool number_unsigned(number_unsigned_t val) override
+  {
+    if (in_vertices())
+    {
+      m_vertices->add(static_cast<int64_t>(val));
+      return true;
+    }
+
+    return value(json(val));
+  }
+
+  bool number_float(number_float_t val, const string_t&) override
+  {
+    if (in_vertices())
+    {
+      m_vertices->add(static_cast<double>(val));
+      return true;
+    }
+
+    return value(json(val));
+  }
+
+  bool string(string_t& val) override
+  {
+    return value(json(std::move(val)));
+  }
+
+  bool start_object(std::size_t) override
+  {
+    return open(json::value_t::object);
+  }
+
+  bool key(string_t& val) override
+  {
+    if (capturing())
+    {
+      m_key = std::move(val);
+    }
+    else if (m_depth == 1)
+    {
+      m_member = std::move(val);
+    }
+    else if (m_depth == 2 && m_member == "CityObjects")
+    {
+      m_object_count++;
+      m_object_id = std::move(val);
+    }
+    else if (m_depth == 3 && m_member == "CityObjects")
+    {
+      m_object_member = val;
+    }
+
+    return true;
+  }
+
+  bool end_object() override
+  {
+    return close();
+  }
+
+  bool start_array(std::size_t) override
+  {
+    return open(json::value_t::array);
+  }
+
+  bool end_array() override
+  {
+    return close();
+  }
+
+  // Rethrows ex as the exception type it was created as, by its id, as
+  // nlohmann's own DOM parser does, so that it is not sliced to its base
+  bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& ex) override
+  {
+    switch ((ex.id / 100) % 100)
+    {
+      case 1:
+        throw static_cast<const nlohmann::detail::parse_error&>(ex);
+      case 2:
+        throw static_cast<const nlohmann::detail::invalid_iterator&>(ex);
+      case 3:
+        throw static_cast<const nlohmann::detail::type_error&>(ex);
+      case 4:
+        throw static_cast<const nlohmann::detail::out_of_range&>(ex);
+      default:
+        throw static_cast<const nlohmann::detail::other_error&>(ex);
+    }
+  }
+
+private:
+  bool capturing() const
+  {
+    return !m_stack.empty();
+  }
+
+  // Whether a number is a coordinate of "vertices" (root > vertices > vertex)
+  bool in_vertices() const
+  {
+    return m_vertices != nullptr && m_depth == 3 && m_member == "vertices";
+  }
+
+  // Whether the value starting at the current position has to be built
+  bool wanted() const
+  {
+    if (m_header != nullptr)
+    {
+      return m_depth == 1 && m_member == "transform";
+    }
+
+    return m_depth == 2 && m_member == "CityObjects";
+  }
+
+  // Adds a value to the container being built and returns where it landed
+  json* add(json&& val)
+  {
+    json* parent = m_stack.back();
+    if (parent->is_array())
+    {
+      parent->push_back(std::move(val));
+      return &parent->back();
+    }
+
+    json& slot = (*parent)[m_key];
+    slot = std::move(val);
+    return &slot;
+  }
+
+  bool value(json&& val)
+  {
+    if (capturing())
+    {
+      add(std::move(val));
+      return true;
+    }
+
+    if (wanted())
+    {
+      m_value = std::move(val);
+      return deliver();
+    }
+
+    return true;
+  }
+
+  bool open(json::value_t type)
+  {
+    if (m_depth == 4 && m_member == "CityObjects" && m_object_member == "geometry")
+    {
+      m_geometry_count++;
+    }
+
+    if (capturing())
+    {
+      m_stack.push_back(add(json(type)));
+    }
+    else if (wanted())
+    {
+      m_value = json(type);
+      m_stack.push_back(&m_value);
+    }
+
+    m_depth++;
+    return true;
+  }
+
+  bool close()
+  {
+    m_depth--;
+
+    if (capturing())
+    {
+      m_stack.pop_back();
+      if (m_stack.empty())
+      {
+        return deliver();
+      }
+    }
+
+    return true;
+  }
+
+  bool deliver()
+  {
+    if (m_header != nullptr)
+    {
+      (*m_header)[m_member] = std::move(m_value);
+    }
+    else if (!m_callback(m_object_id, m_value))
+    {
+      m_stopped = true;
+      return false;
+    }
+
+    m_value = json();
+    return true;
+  }
+
+  json* m_header;
+  Vertex_buffer* m_vertices;
+  Object_callback m_callback;
+  std::size_t m_object_count, m_geometry_count;
+
+  std::size_t m_depth;
+  std::string m_member, m_object_id, m_object_member, m_key;
+
+  std::vector<json*> m_stack;
+  json m_value;
+  bool m_stopped;
+};
+
+#endif
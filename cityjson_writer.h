@@ -0,0 +1,57 @@
+#ifndef CITYJSON_WRITER_H
+#define CITYJSON_WRITER_H
+
+#include <cctype>
+#include <ostream>
+
+#include "typedefs.h"
+#include "darts_writer.h"
+#include "mapped_file.h"
+#include "thirdparty/json.hpp"
+
+// Writes the city model with the +darts member of lcc added, in the order
+// nlohmann::json would write the member it sorts first
+inline void write_cityjson_with_darts(std::ostream& output, const nlohmann::json& city, const LCC& lcc)
+{
+  output << "{\"+darts\":";
+  write_darts(output, lcc);
+
+  for (auto it = city.begin(); it != city.end(); ++it)
+  {
+    if (it.key() != "+darts")
+    {
+      output << "," << nlohmann::json(it.key()) << ":" << it.value();
+    }
+  }
+  output << "}";
+}
+
+// Writes the CityJSON document in input with the +darts member added in
+// front, copying the rest of the text as it is instead of re-serializing it.
+inline void copy_cityjson_with_darts(const Mapped_file& input, std::ostream& output, const LCC& lcc)
+{
+  const char* c = input.begin();
+  while (c != input.end() && *c != '{')
+  {
+    c++;
+  }
+  if (c != input.end())
+  {
+    c++;
+  }
+
+  output << "{\"+darts\":";
+  write_darts(output, lcc);
+
+  while (c != input.end() && std::isspace(static_cast<unsigned char>(*c)))
+  {
+    c++;
+  }
+  if (c != input.end() && *c != '}')
+  {
+    output << ",";
+  }
+  output.write(c, input.end() - c);
+}
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef DART_NUMBERING_H
+#define DART_NUMBERING_H
+
+#include <cstdint>
+
+#include "typedefs.h"
+#include "flat_hash_map.h"
+#include "vertex_key.h"
+
+// Hash of a dart or attribute handle by the address it refers to
+struct Handle_hash
+{
+  template <class Handle>
+  std::size_t operator()(const Handle& handle) const
+  {
+    return static_cast<std::size_t>(mix_key_bits(reinterpret_cast<uintptr_t>(&*handle)));
+  }
+};
+
+// Numbers the darts of an LCC from first, in iteration order, filled once
+// so that the number of any dart is a single hash lookup. The LCC must not
+// gain or lose darts while the numbering is used.
+class Dart_numbering
+{
+public:
+  Dart_numbering(const LCC& lcc, LCC::size_type first = 0)
+  {
+    m_numbers.reserve(lcc.number_of_darts());
+
+    LCC::size_type num = first;
+    for (LCC::Dart_range::const_iterator it = lcc.darts().begin(); it != lcc.darts().end(); ++it)
+    {
+      m_numbers.find_or_insert(it, num++);
+    }
+  }
+
+  LCC::size_type operator[](LCC::Dart_const_handle dart) const
+  {
+    return m_numbers.find(dart)->value;
+  }
+
+private:
+  Flat_hash_map<LCC::Dart_const_handle, LCC::size_type, Handle_hash> m_numbers;
+};
+
+#endif
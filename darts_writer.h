@@ -0,0 +1,74 @@
+#ifndef DARTS_WRITER_H
+#define DARTS_WRITER_H
+
+#include <cstdint>
+#include <ostream>
+
+#include "typedefs.h"
+#include "buffered_writer.h"
+#include "dart_numbering.h"
+
+// Writes the +darts object of the LCC extension for lcc: the darts are
+// numbered from 1 in iteration order and each array is written in its own
+// pass over them, without building a json tree.
+inline void write_darts(std::ostream& output, const LCC& lcc)
+{
+  Dart_numbering numbers(lcc, 1);
+
+  Buffered_writer writer(output);
+
+  writer.put("{\"count\":");
+  writer.put_integer(static_cast<int64_t>(lcc.number_of_darts()));
+
+  writer.put(",\"vertices\":[");
+  for (LCC::Dart_range::const_iterator it = lcc.darts().begin(); it != lcc.darts().end(); ++it)
+  {
+    if (it != lcc.darts().begin())
+      writer.put(',');
+    writer.put_integer(static_cast<int64_t>(lcc.info<0>(it).vertex()));
+  }
+
+  // The betas, -1 for free ones
+  writer.put("],\"betas\":[");
+  for (LCC::Dart_range::const_iterator it = lcc.darts().begin(); it != lcc.darts().end(); ++it)
+  {
+    if (it != lcc.darts().begin())
+      writer.put(',');
+    writer.put('[');
+    for (unsigned int dim = 1; dim <= lcc.dimension; dim++)
+    {
+      if (dim > 1)
+        writer.put(',');
+      if (!lcc.is_free(it, dim))
+        writer.put_integer(static_cast<int64_t>(numbers[lcc.beta(it, dim)]));
+      else
+        writer.put_integer(-1);
+    }
+    writer.put(']');
+  }
+
+  writer.put("],\"parentCityObjects\":[");
+  for (LCC::Dart_range::const_iterator it = lcc.darts().begin(); it != lcc.darts().end(); ++it)
+  {
+    if (it != lcc.darts().begin())
+      writer.put(',');
+    writer.put_json_string(lcc.info<2>(it).get_guid());
+  }
+
+  // Geometry id and semantic surface id of the face of each dart
+  writer.put("],\"semanticSurfaces\":[");
+  for (LCC::Dart_range::const_iterator it = lcc.darts().begin(); it != lcc.darts().end(); ++it)
+  {
+    if (it != lcc.darts().begin())
+      writer.put(',');
+    writer.put('[');
+    writer.put_integer(lcc.info<2>(it).get_geometry_id());
+    writer.put(',');
+    writer.put_integer(lcc.info<2>(it).get_semantic_surface_id());
+    writer.put(']');
+  }
+
+  writer.put("]}");
+}
+
+#endif
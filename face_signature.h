@@ -0,0 +1,205 @@
+#ifndef FACE_SIGNATURE_H
+#define FACE_SIGNATURE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "vertex_key.h"
+
+// Orientation-aware identity of a face, looked up in the 2-cell index: the
+// ring of vertex ids rotated so that it starts with its lexicographically
+// smallest rotation, plus a hash of that sequence computed once.
+struct Face_signature
+{
+  std::vector<uint32_t> ids;
+  uint64_t hash;
+
+  Face_signature() : hash(0)
+  {}
+
+  bool operator==(const Face_signature& other) const
+  {
+    return hash == other.hash && ids == other.ids;
+  }
+};
+
+inline std::ostream& operator<<(std::ostream& os, const Face_signature& s)
+{
+  for (std::vector<uint32_t>::const_iterator it = s.ids.begin(); it != s.ids.end(); ++it)
+  {
+    if (it != s.ids.begin())
+      os << "-";
+    os << *it;
+  }
+  return os;
+}
+
+// Position in ring of the least rotation of the ring walked forward, or
+// backward when reversed is set.
+inline std::size_t least_rotation(const std::vector<uint32_t>& ring, bool reversed)
+{
+  const std::size_t n = ring.size();
+  const std::size_t step = reversed ? n - 1 : 1;
+
+  std::size_t best = 0;
+  for (std::size_t i = 1; i < n; i++)
+  {
+    if (ring[i] < ring[best])
+    {
+      best = i;
+    }
+    else if (ring[i] == ring[best])
+    {
+      // Only repeated vertices need the full comparison
+      for (std::size_t k = 1; k < n; k++)
+      {
+        uint32_t a = ring[(i + k * step) % n];
+        uint32_t b = ring[(best + k * step) % n];
+        if (a != b)
+        {
+          if (a < b)
+          {
+            best = i;
+          }
+          break;
+        }
+      }
+    }
+  }
+
+  return best;
+}
+
+// Fills signature with the canonical form of ring (walked backward when
+// reversed is set) and returns the position in ring where it starts. The
+// signature's storage is reused, so building one per face does not allocate
+// in steady state.
+inline std::size_t make_face_signature(const std::vector<uint32_t>& ring, bool reversed, Face_signature& signature)
+{
+  const std::size_t n = ring.size();
+  const std::size_t step = reversed ? n - 1 : 1;
+  const std::size_t start = least_rotation(ring, reversed);
+
+  signature.ids.resize(n);
+  uint64_t hash = n;
+  for (std::size_t k = 0; k < n; k++)
+  {
+    signature.ids[k] = ring[(start + k * step) % n];
+    hash = combine_key_bits(hash, signature.ids[k]);
+  }
+  signature.hash = hash;
+
+  return start;
+}
+
+// Key of the 2-cell index: a signature whose ids lie in a shared pool, so
+// that indexing a face copies them there instead of allocating a vector.
+// A key viewing a Face_signature is used to look one up.
+struct Face_key
+{
+  const std::vector<uint32_t>* pool;
+  uint32_t offset, size;
+  uint64_t hash;
+
+  Face_key() : pool(nullptr), offset(0), size(0), hash(0)
+  {}
+
+  explicit Face_key(const Face_signature& signature) :
+    pool(&signature.ids), offset(0), size(static_cast<uint32_t>(signature.ids.size())), hash(signature.hash)
+  {}
+
+  const uint32_t* begin() const
+  {
+    return pool->data() + offset;
+  }
+
+  const uint32_t* end() const
+  {
+    return begin() + size;
+  }
+
+  bool operator==(const Face_key& other) const
+  {
+    return hash == other.hash && size == other.size && std::equal(begin(), end(), other.begin());
+  }
+};
+
+struct Face_key_hash
+{
+  std::size_t operator()(const Face_key& k) const
+  {
+    return static_cast<std::size_t>(k.hash);
+  }
+};
+
+inline std::ostream& operator<<(std::ostream& os, const Face_key& k)
+{
+  for (const uint32_t* it = k.begin(); it != k.end(); ++it)
+  {
+    if (it != k.begin())
+      os << "-";
+    os << *it;
+  }
+  return os;
+}
+
+// Pool of the ids of indexed faces. Released ids are reclaimed by
+// compacting the pool once they are the majority, so it keeps its capacity
+// and stops allocating once the index has reached its working size.
+class Face_signature_pool
+{
+public:
+  Face_signature_pool() : m_released(0)
+  {}
+
+  Face_key add(const Face_signature& signature)
+  {
+    Face_key key(signature);
+    key.pool = &m_ids;
+    key.offset = static_cast<uint32_t>(m_ids.size());
+    m_ids.insert(m_ids.end(), signature.ids.begin(), signature.ids.end());
+    return key;
+  }
+
+  void release(const Face_key& key)
+  {
+    m_released += key.size;
+  }
+
+  // Moves the ids of the keys of index together once more than half of
+  // the pool was released. Offsets change, hashes do not, so the index
+  // stays valid.
+  template <class Index>
+  void compact(Index& index)
+  {
+    if (m_released * 2 <= m_ids.size() || m_released < 4096)
+    {
+      return;
+    }
+
+    m_compacted.clear();
+    index.for_each([this](typename Index::Entry& entry)
+    {
+      uint32_t offset = static_cast<uint32_t>(m_compacted.size());
+      m_compacted.insert(m_compacted.end(), entry.key.begin(), entry.key.end());
+      entry.key.offset = offset;
+    });
+    m_ids.swap(m_compacted);
+    m_released = 0;
+  }
+
+  void clear()
+  {
+    m_ids.clear();
+    m_released = 0;
+  }
+
+private:
+  std::vector<uint32_t> m_ids;
+  std::vector<uint32_t> m_compacted;
+  std::size_t m_released;
+};
+
+#endif
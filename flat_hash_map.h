@@ -0,0 +1,203 @@
+#ifndef FLAT_HASH_MAP_H
+#define FLAT_HASH_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Open-addressing hash map with linear probing, used for the reconstruction
+// indexes. Entries live in one contiguous array and erasing shifts the
+// following entries back, so there are no tombstones and lookups stay short
+// even after millions of insert/erase cycles.
+//
+// Pointers returned by find() and find_or_insert() are invalidated by any
+// later insertion or erase.
+template <class Key, class Value, class Hash>
+class Flat_hash_map
+{
+public:
+  struct Entry
+  {
+    Key key;
+    Value value;
+  };
+
+  Flat_hash_map() : m_size(0), m_mask(0)
+  {}
+
+  std::size_t size() const
+  {
+    return m_size;
+  }
+
+  bool empty() const
+  {
+    return m_size == 0;
+  }
+
+  // Empties the map but keeps its capacity
+  void clear()
+  {
+    for (std::size_t i = 0; i < m_entries.size(); i++)
+    {
+      if (m_used[i])
+      {
+        m_entries[i] = Entry();
+        m_used[i] = 0;
+      }
+    }
+    m_size = 0;
+  }
+
+  void reserve(std::size_t count)
+  {
+    std::size_t capacity = 16;
+    while (capacity < count * 2)
+    {
+      capacity *= 2;
+    }
+
+    if (capacity > m_entries.size())
+    {
+      rehash(capacity);
+    }
+  }
+
+  Entry* find(const Key& key)
+  {
+    if (m_size == 0)
+    {
+      return nullptr;
+    }
+
+    for (std::size_t i = slot(key); m_used[i]; i = (i + 1) & m_mask)
+    {
+      if (m_entries[i].key == key)
+      {
+        return &m_entries[i];
+      }
+    }
+
+    return nullptr;
+  }
+
+  const Entry* find(const Key& key) const
+  {
+    return const_cast<Flat_hash_map*>(this)->find(key);
+  }
+
+  // Returns the entry for key and whether it was created. A new entry is
+  // initialized with value; an existing one is left untouched.
+  std::pair<Entry*, bool> find_or_insert(const Key& key, const Value& value)
+  {
+    if ((m_size + 1) * 2 > m_entries.size())
+    {
+      rehash(m_entries.empty() ? 16 : m_entries.size() * 2);
+    }
+
+    std::size_t i = slot(key);
+    for (; m_used[i]; i = (i + 1) & m_mask)
+    {
+      if (m_entries[i].key == key)
+      {
+        return std::make_pair(&m_entries[i], false);
+      }
+    }
+
+    m_used[i] = 1;
+    m_entries[i].key = key;
+    m_entries[i].value = value;
+    m_size++;
+
+    return std::make_pair(&m_entries[i], true);
+  }
+
+  Value& operator[](const Key& key)
+  {
+    return find_or_insert(key, Value()).first->value;
+  }
+
+  void erase(Entry* entry)
+  {
+    std::size_t hole = entry - &m_entries[0];
+    m_used[hole] = 0;
+    m_size--;
+
+    // Backward-shift the rest of the cluster into the hole
+    for (std::size_t i = (hole + 1) & m_mask; m_used[i]; i = (i + 1) & m_mask)
+    {
+      std::size_t home = slot(m_entries[i].key);
+      if (((i - home) & m_mask) >= ((i - hole) & m_mask))
+      {
+        m_entries[hole] = std::move(m_entries[i]);
+        m_used[hole] = 1;
+        m_used[i] = 0;
+        hole = i;
+      }
+    }
+
+    m_entries[hole] = Entry();
+  }
+
+  bool erase(const Key& key)
+  {
+    Entry* entry = find(key);
+    if (entry == nullptr)
+    {
+      return false;
+    }
+
+    erase(entry);
+    return true;
+  }
+
+  template <class F>
+  void for_each(F f)
+  {
+    for (std::size_t i = 0; i < m_entries.size(); i++)
+    {
+      if (m_used[i])
+      {
+        f(m_entries[i]);
+      }
+    }
+  }
+
+private:
+  std::size_t slot(const Key& key) const
+  {
+    return Hash()(key) & m_mask;
+  }
+
+  void rehash(std::size_t capacity)
+  {
+    std::vector<Entry> old_entries(capacity);
+    std::vector<unsigned char> old_used(capacity, 0);
+    old_entries.swap(m_entries);
+    old_used.swap(m_used);
+    m_mask = capacity - 1;
+
+    for (std::size_t i = 0; i < old_entries.size(); i++)
+    {
+      if (old_used[i])
+      {
+        std::size_t j = slot(old_entries[i].key);
+        while (m_used[j])
+        {
+          j = (j + 1) & m_mask;
+        }
+
+        m_entries[j] = std::move(old_entries[i]);
+        m_used[j] = 1;
+      }
+    }
+  }
+
+  std::vector<Entry> m_entries;
+  std::vector<unsigned char> m_used;
+  std::size_t m_size;
+  std::size_t m_mask;
+};
+
+#endif
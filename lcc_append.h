@@ -0,0 +1,81 @@
+#ifndef LCC_APPEND_H
+#define LCC_APPEND_H
+
+#include <cstdint>
+
+#include "typedefs.h"
+#include "flat_hash_map.h"
+#include "dart_numbering.h"
+
+typedef Flat_hash_map<Dart_handle, Dart_handle, Handle_hash> Dart_copies;
+
+// Copies every dart of source into target, in the iteration order of source,
+// with its betas and attributes, and maps each dart of source to its copy.
+// Volumes get a new attribute with the guid and attributes of the original
+// but a color drawn by the caller's thread, so colors only depend on the
+// order of the appends.
+inline void append_lcc(LCC& target, LCC& source, Dart_copies& copies)
+{
+  Flat_hash_map<LCC::Vertex_attribute_handle, LCC::Vertex_attribute_handle, Handle_hash> points;
+
+  copies.clear();
+  copies.reserve(source.number_of_darts());
+  for (LCC::Dart_range::iterator it = source.darts().begin(); it != source.darts().end(); ++it)
+  {
+    Dart_handle dart = it;
+    auto point = points.find_or_insert(source.vertex_attribute(dart), LCC::Vertex_attribute_handle());
+    if (point.second)
+    {
+      point.first->value = target.create_vertex_attribute(source.point(dart));
+    }
+
+    Dart_handle copy = target.create_dart(point.first->value);
+    if (point.second)
+    {
+      target.info<0>(copy) = source.info<0>(dart);
+    }
+
+    copies.find_or_insert(dart, copy);
+  }
+
+  for (LCC::Dart_range::iterator it = source.darts().begin(); it != source.darts().end(); ++it)
+  {
+    Dart_handle dart = it;
+    Dart_handle copy = copies.find(dart)->value;
+
+    if (!source.is_free(dart, 1))
+    {
+      target.link_beta<1>(copy, copies.find(source.beta(dart, 1))->value, false);
+    }
+    if (!source.is_free(dart, 2) && target.is_free(copy, 2))
+    {
+      target.link_beta<2>(copy, copies.find(source.beta(dart, 2))->value, false);
+    }
+    if (!source.is_free(dart, 3) && target.is_free(copy, 3))
+    {
+      target.link_beta<3>(copy, copies.find(source.beta(dart, 3))->value, false);
+    }
+  }
+
+  // Cells are complete now, so each attribute is set once on its whole cell
+  for (LCC::Dart_range::iterator it = source.darts().begin(); it != source.darts().end(); ++it)
+  {
+    Dart_handle dart = it;
+    Dart_handle copy = copies.find(dart)->value;
+
+    if (source.attribute<2>(dart) != LCC::null_handle && target.attribute<2>(copy) == LCC::null_handle)
+    {
+      target.set_attribute<2>(copy, target.create_attribute<2>());
+      target.info<2>(copy) = source.info<2>(dart);
+    }
+
+    if (source.attribute<3>(dart) != LCC::null_handle && target.attribute<3>(copy) == LCC::null_handle)
+    {
+      target.set_attribute<3>(copy, target.create_attribute<3>());
+      target.info<3>(copy).set_object_index(source.info<3>(dart).get_object_index());
+      target.info<3>(copy).set_attributes(source.info<3>(dart).get_attributes());
+    }
+  }
+}
+
+#endif
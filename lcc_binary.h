@@ -0,0 +1,606 @@
+#ifndef LCC_BINARY_H
+#define LCC_BINARY_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "typedefs.h"
+#include "flat_hash_map.h"
+#include "dart_numbering.h"
+
+// Binary container for an LCC, an alternative to the XML .3map. The file is
+// a header followed by fixed-width tables, each starting on an 8-byte
+// boundary, in native byte order:
+//
+//   darts       betas 1 to 3, point, face and volume of each dart
+//   points      coordinates and CityJSON vertex index
+//   faces       Face_record and first dart of each face attribute, the faces
+//               of each object next to each other
+//   objects     id and face range of each object, sorted by id
+//   volumes     object, color, status and attribute range of each volume
+//   attributes  key and value string of each volume attribute
+//   strings     string_count + 1 offsets, then the bytes of all strings
+//
+// Everything refers to other records by index, with lccb_none for none.
+// Object ids are strings of the string table.
+
+const uint32_t lccb_none = 0xffffffffu;
+const uint32_t lccb_version = 2;
+const char lccb_magic[8] = {'L', 'C', 'C', 'B', 'I', 'N', '\r', '\n'};
+
+struct Lccb_header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t dimension;
+  uint64_t dart_count;
+  uint64_t point_count;
+  uint64_t face_count;
+  uint64_t object_count;
+  uint64_t volume_count;
+  uint64_t attribute_count;
+  uint64_t string_count;
+  uint64_t string_bytes;
+};
+
+struct Lccb_dart
+{
+  uint32_t beta[3];
+  uint32_t point;
+  uint32_t face;
+  uint32_t volume;
+};
+
+struct Lccb_point
+{
+  double coordinates[3];
+  uint64_t vertex;
+};
+
+struct Lccb_face
+{
+  uint32_t object;
+  int32_t geometry_id;
+  int32_t semantic_surface_id;
+  uint32_t dart;
+};
+
+struct Lccb_object
+{
+  uint32_t id;
+  uint32_t first_face;
+  uint32_t face_count;
+  uint32_t reserved;
+};
+
+struct Lccb_volume
+{
+  uint32_t object;
+  uint8_t color[3];
+  uint8_t status;
+  uint32_t first_attribute;
+  uint32_t attribute_count;
+};
+
+struct Lccb_attribute
+{
+  uint32_t key;
+  uint32_t value;
+};
+
+static_assert(sizeof(Lccb_header) == 80 && sizeof(Lccb_dart) == 24 && sizeof(Lccb_point) == 32 &&
+              sizeof(Lccb_face) == 16 && sizeof(Lccb_object) == 16 && sizeof(Lccb_volume) == 16 &&
+              sizeof(Lccb_attribute) == 8,
+              "binary LCC records must not be padded");
+
+// Bytes of padding after size bytes to reach the next 8-byte boundary
+inline std::size_t lccb_padding(std::size_t size)
+{
+  return (8 - size % 8) % 8;
+}
+
+// Strings of a file being written, each stored once
+class Lccb_string_table
+{
+public:
+  uint32_t add(const std::string& s)
+  {
+    uint32_t next_index = static_cast<uint32_t>(m_offsets.size());
+    auto entry = m_indices.find_or_insert(s, next_index);
+    if (entry.second)
+    {
+      m_offsets.push_back(m_bytes.size());
+      m_bytes += s;
+    }
+
+    return entry.first->value;
+  }
+
+  std::size_t size() const
+  {
+    return m_offsets.size();
+  }
+
+  void write(std::ostream& output) const
+  {
+    std::vector<uint64_t> offsets(m_offsets);
+    offsets.push_back(m_bytes.size());
+    output.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint64_t));
+    output.write(m_bytes.data(), m_bytes.size());
+
+    static const char zeros[8] = {0};
+    output.write(zeros, lccb_padding(m_bytes.size()));
+  }
+
+  std::size_t byte_count() const
+  {
+    return m_bytes.size();
+  }
+
+  // Whether string a sorts before string b
+  bool less(uint32_t a, uint32_t b) const
+  {
+    return m_bytes.compare(m_offsets[a], end(a) - m_offsets[a], m_bytes, m_offsets[b], end(b) - m_offsets[b]) < 0;
+  }
+
+private:
+  uint64_t end(uint32_t index) const
+  {
+    return index + 1 < m_offsets.size() ? m_offsets[index + 1] : m_bytes.size();
+  }
+
+  std::vector<uint64_t> m_offsets;
+  std::string m_bytes;
+  Flat_hash_map<std::string, uint32_t, std::hash<std::string> > m_indices;
+};
+
+template <class Record>
+void write_lccb_table(std::ostream& output, const std::vector<Record>& records)
+{
+  static const char zeros[8] = {0};
+
+  std::size_t size = records.size() * sizeof(Record);
+  output.write(reinterpret_cast<const char*>(records.data()), size);
+  output.write(zeros, lccb_padding(size));
+}
+
+// Reorders faces so that the faces of each object are next to each other,
+// the objects sorted by id, renumbers the faces of darts to match and returns
+// the face range of each object
+inline std::vector<Lccb_object> group_lccb_faces(std::vector<Lccb_face>& faces, std::vector<Lccb_dart>& darts,
+                                                 const Lccb_string_table& strings)
+{
+  std::vector<uint32_t> ids;
+  std::vector<uint32_t> ranks(strings.size(), lccb_none);
+  for (const Lccb_face& face : faces)
+  {
+    if (ranks[face.object] == lccb_none)
+    {
+      ranks[face.object] = 0;
+      ids.push_back(face.object);
+    }
+  }
+  std::sort(ids.begin(), ids.end(), [&strings](uint32_t a, uint32_t b)
+  {
+    return strings.less(a, b);
+  });
+
+  std::vector<Lccb_object> objects(ids.size());
+  for (std::size_t r = 0; r < ids.size(); r++)
+  {
+    ranks[ids[r]] = static_cast<uint32_t>(r);
+    Lccb_object object = {ids[r], 0, 0, 0};
+    objects[r] = object;
+  }
+  for (const Lccb_face& face : faces)
+  {
+    objects[ranks[face.object]].face_count++;
+  }
+
+  std::vector<uint32_t> next_face(objects.size());
+  uint32_t first_face = 0;
+  for (std::size_t r = 0; r < objects.size(); r++)
+  {
+    objects[r].first_face = first_face;
+    next_face[r] = first_face;
+    first_face += objects[r].face_count;
+  }
+
+  std::vector<uint32_t> new_indices(faces.size());
+  std::vector<Lccb_face> grouped(faces.size());
+  for (std::size_t f = 0; f < faces.size(); f++)
+  {
+    new_indices[f] = next_face[ranks[faces[f].object]]++;
+    grouped[new_indices[f]] = faces[f];
+  }
+  faces.swap(grouped);
+
+  for (Lccb_dart& dart : darts)
+  {
+    if (dart.face != lccb_none)
+    {
+      dart.face = new_indices[dart.face];
+    }
+  }
+
+  return objects;
+}
+
+// Throws runtime_error if count records cannot all have a uint32_t index
+// other than lccb_none
+inline void check_lccb_count(std::size_t count, const char* records)
+{
+  if (count >= lccb_none)
+  {
+    throw std::runtime_error(std::string("Too many ") + records + " for a binary LCC file");
+  }
+}
+
+inline void save_lcc_binary(const LCC& lcc, const char* filename)
+{
+  // Points, faces and volumes are no more than darts
+  check_lccb_count(lcc.number_of_darts(), "darts");
+
+  Dart_numbering darts(lcc);
+  Flat_hash_map<LCC::Vertex_attribute_const_handle, uint32_t, Handle_hash> point_indices;
+  Flat_hash_map<LCC::Attribute_const_handle<2>::type, uint32_t, Handle_hash> face_indices;
+  Flat_hash_map<LCC::Attribute_const_handle<3>::type, uint32_t, Handle_hash> volume_indices;
+
+  std::vector<Lccb_dart> dart_records;
+  std::vector<Lccb_point> points;
+  std::vector<Lccb_face> faces;
+  std::vector<Lccb_volume> volumes;
+  std::vector<Lccb_attribute> attributes;
+  Lccb_string_table strings;
+
+  dart_records.reserve(lcc.number_of_darts());
+  for (LCC::Dart_range::const_iterator it = lcc.darts().begin(); it != lcc.darts().end(); ++it)
+  {
+    Lccb_dart record;
+    for (unsigned int dim = 1; dim <= 3; dim++)
+    {
+      record.beta[dim - 1] = lcc.is_free(it, dim) ? lccb_none : static_cast<uint32_t>(darts[lcc.beta(it, dim)]);
+    }
+
+    auto point = point_indices.find_or_insert(lcc.vertex_attribute(it), static_cast<uint32_t>(points.size()));
+    if (point.second)
+    {
+      Lccb_point p = {{lcc.point(it).x(), lcc.point(it).y(), lcc.point(it).z()},
+                      static_cast<uint64_t>(lcc.info<0>(it).vertex())};
+      points.push_back(p);
+    }
+    record.point = point.first->value;
+
+    record.face = lccb_none;
+    if (lcc.attribute<2>(it) != LCC::null_handle)
+    {
+      auto face = face_indices.find_or_insert(lcc.attribute<2>(it), static_cast<uint32_t>(faces.size()));
+      if (face.second)
+      {
+        const Face_info& info = lcc.info<2>(it);
+        Lccb_face f = {strings.add(info.get_guid()), info.get_geometry_id(), info.get_semantic_surface_id(),
+                       static_cast<uint32_t>(dart_records.size())};
+        faces.push_back(f);
+      }
+      record.face = face.first->value;
+    }
+
+    record.volume = lccb_none;
+    if (lcc.attribute<3>(it) != LCC::null_handle)
+    {
+      auto volume = volume_indices.find_or_insert(lcc.attribute<3>(it), static_cast<uint32_t>(volumes.size()));
+      if (volume.second)
+      {
+        const Volume_info& info = lcc.info<3>(it);
+        Lccb_volume v;
+        v.object = strings.add(info.get_guid());
+        v.color[0] = info.color().red();
+        v.color[1] = info.color().green();
+        v.color[2] = info.color().blue();
+        v.status = static_cast<uint8_t>((info.is_visible() ? LCC_DEMO_VISIBLE : 0) | (info.is_filled() ? LCC_DEMO_FILLED : 0));
+        v.first_attribute = static_cast<uint32_t>(attributes.size());
+        v.attribute_count = static_cast<uint32_t>(info.get_attributes().size());
+        for (auto& attribute : info.get_attributes())
+        {
+          Lccb_attribute a = {strings.add(attribute.first), strings.add(attribute.second)};
+          attributes.push_back(a);
+        }
+        volumes.push_back(v);
+      }
+      record.volume = volume.first->value;
+    }
+
+    dart_records.push_back(record);
+  }
+
+  check_lccb_count(attributes.size(), "attributes");
+  check_lccb_count(strings.size(), "strings");
+
+  std::vector<Lccb_object> objects = group_lccb_faces(faces, dart_records, strings);
+
+  Lccb_header header;
+  std::memcpy(header.magic, lccb_magic, sizeof(header.magic));
+  header.version = lccb_version;
+  header.dimension = 3;
+  header.dart_count = dart_records.size();
+  header.point_count = points.size();
+  header.face_count = faces.size();
+  header.object_count = objects.size();
+  header.volume_count = volumes.size();
+  header.attribute_count = attributes.size();
+  header.string_count = strings.size();
+  header.string_bytes = strings.byte_count();
+
+  std::ofstream output(filename, std::ios::binary);
+  output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  write_lccb_table(output, dart_records);
+  write_lccb_table(output, points);
+  write_lccb_table(output, faces);
+  write_lccb_table(output, objects);
+  write_lccb_table(output, volumes);
+  write_lccb_table(output, attributes);
+  strings.write(output);
+}
+
+// Adds to size the bytes of a table of count records and its padding.
+// Throws runtime_error if they do not fit in the file_size bytes of the
+// file, before anything of that size is allocated.
+template <class Record>
+void add_lccb_table_size(uint64_t& size, uint64_t count, uint64_t file_size)
+{
+  if (count > file_size / sizeof(Record) || size + count * sizeof(Record) > file_size)
+  {
+    throw std::runtime_error("Binary LCC file is truncated");
+  }
+
+  size += count * sizeof(Record);
+  size += lccb_padding(static_cast<std::size_t>(size));
+}
+
+template <class Record>
+void read_lccb_table(std::istream& input, std::vector<Record>& records, uint64_t count)
+{
+  records.resize(count);
+
+  std::size_t size = records.size() * sizeof(Record);
+  input.read(reinterpret_cast<char*>(records.data()), size);
+  input.ignore(lccb_padding(size));
+}
+
+// Throws runtime_error unless index refers to one of count records, or is
+// lccb_none where none is allowed
+inline void check_lccb_index(uint64_t index, uint64_t count, bool none_allowed = true)
+{
+  if (index >= count && !(none_allowed && index == lccb_none))
+  {
+    throw std::runtime_error("Binary LCC file refers to a missing record");
+  }
+}
+
+// Throws runtime_error unless the string_count + 1 offsets of the string
+// table split its string_bytes bytes in order
+inline void check_lccb_string_offsets(const uint64_t* offsets, uint64_t string_count, uint64_t string_bytes)
+{
+  for (uint64_t i = 0; i < string_count; i++)
+  {
+    if (offsets[i] > offsets[i + 1])
+    {
+      throw std::runtime_error("Binary LCC file has a damaged string table");
+    }
+  }
+  if (offsets[0] != 0 || offsets[string_count] != string_bytes)
+  {
+    throw std::runtime_error("Binary LCC file has a damaged string table");
+  }
+}
+
+// Loads a file written by save_lcc_binary into lcc, which should be empty.
+// Throws runtime_error if the file is not such a file, is truncated or
+// refers to records it does not have.
+inline void load_lcc_binary(const char* filename, LCC& lcc)
+{
+  std::ifstream input(filename, std::ios::binary);
+
+  Lccb_header header;
+  if (!input.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+      std::memcmp(header.magic, lccb_magic, sizeof(header.magic)) != 0)
+  {
+    throw std::runtime_error(std::string(filename) + " is not a binary LCC file");
+  }
+  if (header.version != lccb_version || header.dimension != 3)
+  {
+    throw std::runtime_error(std::string(filename) + " has an unsupported version or dimension");
+  }
+
+  input.seekg(0, std::ios::end);
+  uint64_t file_size = static_cast<uint64_t>(input.tellg());
+  input.seekg(sizeof(header));
+
+  if (header.dart_count >= lccb_none || header.string_count >= lccb_none)
+  {
+    throw std::runtime_error(std::string(filename) + " has too many records");
+  }
+
+  uint64_t size = sizeof(header);
+  add_lccb_table_size<Lccb_dart>(size, header.dart_count, file_size);
+  add_lccb_table_size<Lccb_point>(size, header.point_count, file_size);
+  add_lccb_table_size<Lccb_face>(size, header.face_count, file_size);
+  add_lccb_table_size<Lccb_object>(size, header.object_count, file_size);
+  add_lccb_table_size<Lccb_volume>(size, header.volume_count, file_size);
+  add_lccb_table_size<Lccb_attribute>(size, header.attribute_count, file_size);
+  add_lccb_table_size<uint64_t>(size, header.string_count + 1, file_size);
+  add_lccb_table_size<char>(size, header.string_bytes, file_size);
+
+  std::vector<Lccb_dart> dart_records;
+  std::vector<Lccb_point> points;
+  std::vector<Lccb_face> faces;
+  std::vector<Lccb_object> objects;
+  std::vector<Lccb_volume> volumes;
+  std::vector<Lccb_attribute> attributes;
+  std::vector<uint64_t> string_offsets;
+  read_lccb_table(input, dart_records, header.dart_count);
+  read_lccb_table(input, points, header.point_count);
+  read_lccb_table(input, faces, header.face_count);
+  read_lccb_table(input, objects, header.object_count);
+  read_lccb_table(input, volumes, header.volume_count);
+  read_lccb_table(input, attributes, header.attribute_count);
+  read_lccb_table(input, string_offsets, header.string_count + 1);
+  std::string string_bytes(header.string_bytes, '\0');
+  input.read(&string_bytes[0], string_bytes.size());
+
+  if (!input)
+  {
+    throw std::runtime_error(std::string(filename) + " is truncated");
+  }
+
+  // Every index is checked before anything is built from it. 2-links and
+  // 3-links have to be mutual and a dart can follow only one other by beta 1.
+  std::vector<bool> has_beta_0(dart_records.size(), false);
+  for (std::size_t i = 0; i < dart_records.size(); i++)
+  {
+    const Lccb_dart& record = dart_records[i];
+    for (unsigned int dim = 1; dim <= 3; dim++)
+    {
+      check_lccb_index(record.beta[dim - 1], header.dart_count);
+    }
+    if (record.beta[0] != lccb_none)
+    {
+      if (has_beta_0[record.beta[0]])
+      {
+        throw std::runtime_error(std::string(filename) + " has a dart linked twice by beta 1");
+      }
+      has_beta_0[record.beta[0]] = true;
+    }
+    for (unsigned int dim = 2; dim <= 3; dim++)
+    {
+      uint32_t other = record.beta[dim - 1];
+      if (other != lccb_none && (other == i || dart_records[other].beta[dim - 1] != i))
+      {
+        throw std::runtime_error(std::string(filename) + " has a beta " + std::to_string(dim) + " that is not mutual");
+      }
+    }
+    check_lccb_index(record.point, header.point_count, false);
+    check_lccb_index(record.face, header.face_count);
+    check_lccb_index(record.volume, header.volume_count);
+  }
+  for (const Lccb_face& face : faces)
+  {
+    check_lccb_index(face.object, header.string_count, false);
+    check_lccb_index(face.dart, header.dart_count, false);
+  }
+  for (const Lccb_object& object : objects)
+  {
+    check_lccb_index(object.id, header.string_count, false);
+    check_lccb_index(static_cast<uint64_t>(object.first_face) + object.face_count, header.face_count + 1, false);
+  }
+  for (const Lccb_volume& volume : volumes)
+  {
+    check_lccb_index(volume.object, header.string_count, false);
+    check_lccb_index(static_cast<uint64_t>(volume.first_attribute) + volume.attribute_count,
+                     header.attribute_count + 1, false);
+  }
+  for (const Lccb_attribute& attribute : attributes)
+  {
+    check_lccb_index(attribute.key, header.string_count, false);
+    check_lccb_index(attribute.value, header.string_count, false);
+  }
+  check_lccb_string_offsets(string_offsets.data(), header.string_count, header.string_bytes);
+
+  auto string_at = [&](uint32_t index)
+  {
+    return string_bytes.substr(string_offsets[index], string_offsets[index + 1] - string_offsets[index]);
+  };
+
+  std::vector<LCC::Vertex_attribute_handle> vertex_attributes(points.size());
+  for (std::size_t i = 0; i < points.size(); i++)
+  {
+    vertex_attributes[i] = lcc.create_vertex_attribute(
+      Point(points[i].coordinates[0], points[i].coordinates[1], points[i].coordinates[2]));
+  }
+
+  std::vector<Dart_handle> darts(dart_records.size());
+  std::vector<bool> has_info(points.size(), false);
+  for (std::size_t i = 0; i < dart_records.size(); i++)
+  {
+    uint32_t p = dart_records[i].point;
+    darts[i] = lcc.create_dart(vertex_attributes[p]);
+    if (!has_info[p])
+    {
+      lcc.info<0>(darts[i]).set_vertex(static_cast<unsigned long>(points[p].vertex));
+      has_info[p] = true;
+    }
+  }
+
+  for (std::size_t i = 0; i < dart_records.size(); i++)
+  {
+    const Lccb_dart& record = dart_records[i];
+    if (record.beta[0] != lccb_none)
+    {
+      lcc.link_beta<1>(darts[i], darts[record.beta[0]], false);
+    }
+    if (record.beta[1] != lccb_none && lcc.is_free(darts[i], 2))
+    {
+      lcc.link_beta<2>(darts[i], darts[record.beta[1]], false);
+    }
+    if (record.beta[2] != lccb_none && lcc.is_free(darts[i], 3))
+    {
+      lcc.link_beta<3>(darts[i], darts[record.beta[2]], false);
+    }
+  }
+
+  // Cells are complete now, so each attribute is set once on its whole cell
+  std::vector<LCC::Attribute_handle<2>::type> face_attributes(faces.size(), LCC::null_handle);
+  std::vector<LCC::Attribute_handle<3>::type> volume_attributes(volumes.size(), LCC::null_handle);
+  for (std::size_t i = 0; i < dart_records.size(); i++)
+  {
+    uint32_t f = dart_records[i].face;
+    if (f != lccb_none && face_attributes[f] == LCC::null_handle)
+    {
+      face_attributes[f] = lcc.create_attribute<2>();
+      lcc.set_attribute<2>(darts[i], face_attributes[f]);
+
+      Face_info& info = lcc.info<2>(darts[i]);
+      info.set_guid(string_at(faces[f].object));
+      info.set_geometry_id(faces[f].geometry_id);
+      info.set_semantic_surface_id(faces[f].semantic_surface_id);
+    }
+
+    uint32_t v = dart_records[i].volume;
+    if (v != lccb_none && volume_attributes[v] == LCC::null_handle)
+    {
+      volume_attributes[v] = lcc.create_attribute<3>();
+      lcc.set_attribute<3>(darts[i], volume_attributes[v]);
+
+      Volume_info& info = lcc.info<3>(darts[i]);
+      info.set_guid(string_at(volumes[v].object));
+      info.color() = CGAL::Color(volumes[v].color[0], volumes[v].color[1], volumes[v].color[2]);
+      info.set_visible((volumes[v].status & LCC_DEMO_VISIBLE) != 0);
+      info.set_filled((volumes[v].status & LCC_DEMO_FILLED) != 0);
+
+      std::map<std::string, std::string> values;
+      for (uint32_t a = 0; a < volumes[v].attribute_count; a++)
+      {
+        const Lccb_attribute& attribute = attributes[volumes[v].first_attribute + a];
+        values[string_at(attribute.key)] = string_at(attribute.value);
+      }
+      info.set_attributes(values);
+    }
+  }
+}
+
+// Same, returning a new LCC
+inline LCC load_lcc_binary(const char* filename)
+{
+  LCC lcc;
+  load_lcc_binary(filename, lcc);
+  return lcc;
+}
+
+#endif
@@ -0,0 +1,274 @@
+#ifndef LCC_SNAPSHOT_H
+#define LCC_SNAPSHOT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "lcc_binary.h"
+#include "mapped_file.h"
+
+// Read-only view of a binary LCC file (see lcc_binary.h) mapped in memory.
+// Its tables are used where they lie in the mapping, so opening a snapshot
+// costs the same whatever its size, and the pages are shared by every job
+// reading the same file. Queries follow the betas and the object table of
+// the file instead of scanning it. Dart, point, face and volume indices are
+// the ones of the file.
+//
+// Opening checks the table sizes, the string table and the indices of the
+// faces and objects, which the queries rely on; the darts are not scanned,
+// and walking them stops at any beta out of range instead.
+class Lcc_snapshot
+{
+public:
+  // Throws runtime_error if filename cannot be mapped, is not a binary LCC
+  // file of a supported version, is truncated or has faces or objects
+  // referring to records it does not have
+  explicit Lcc_snapshot(const std::string& filename) : m_file(filename)
+  {
+    if (!m_file.is_open() || m_file.size() < sizeof(Lccb_header))
+    {
+      throw std::runtime_error("Cannot map " + filename);
+    }
+
+    m_header = reinterpret_cast<const Lccb_header*>(m_file.data());
+    if (std::memcmp(m_header->magic, lccb_magic, sizeof(m_header->magic)) != 0 ||
+        m_header->version != lccb_version || m_header->dimension != 3)
+    {
+      throw std::runtime_error(filename + " is not a supported binary LCC file");
+    }
+
+    if (m_header->dart_count >= lccb_none || m_header->string_count >= lccb_none)
+    {
+      throw std::runtime_error(filename + " has too many records");
+    }
+
+    uint64_t offset = sizeof(Lccb_header);
+    m_darts = table<Lccb_dart>(offset, m_header->dart_count);
+    m_points = table<Lccb_point>(offset, m_header->point_count);
+    m_faces = table<Lccb_face>(offset, m_header->face_count);
+    m_objects = table<Lccb_object>(offset, m_header->object_count);
+    m_volumes = table<Lccb_volume>(offset, m_header->volume_count);
+    m_attributes = table<Lccb_attribute>(offset, m_header->attribute_count);
+    m_string_offsets = table<uint64_t>(offset, m_header->string_count + 1);
+    m_string_bytes = table<char>(offset, m_header->string_bytes);
+
+    check_lccb_string_offsets(m_string_offsets, m_header->string_count, m_header->string_bytes);
+    for (uint64_t f = 0; f < m_header->face_count; f++)
+    {
+      check_lccb_index(m_faces[f].object, m_header->string_count, false);
+      check_lccb_index(m_faces[f].dart, m_header->dart_count, false);
+    }
+    for (uint64_t o = 0; o < m_header->object_count; o++)
+    {
+      check_lccb_index(m_objects[o].id, m_header->string_count, false);
+      check_lccb_index(static_cast<uint64_t>(m_objects[o].first_face) + m_objects[o].face_count,
+                       m_header->face_count + 1, false);
+    }
+  }
+
+  std::size_t number_of_darts() const
+  {
+    return static_cast<std::size_t>(m_header->dart_count);
+  }
+
+  std::size_t number_of_points() const
+  {
+    return static_cast<std::size_t>(m_header->point_count);
+  }
+
+  std::size_t number_of_faces() const
+  {
+    return static_cast<std::size_t>(m_header->face_count);
+  }
+
+  std::size_t number_of_objects() const
+  {
+    return static_cast<std::size_t>(m_header->object_count);
+  }
+
+  std::size_t number_of_volumes() const
+  {
+    return static_cast<std::size_t>(m_header->volume_count);
+  }
+
+  const Lccb_dart& dart(uint32_t d) const
+  {
+    return m_darts[d];
+  }
+
+  // Dart d is linked to by beta(d, dim), dim from 1 to 3, or lccb_none
+  uint32_t beta(uint32_t d, unsigned int dim) const
+  {
+    return m_darts[d].beta[dim - 1];
+  }
+
+  const Lccb_point& point(uint32_t p) const
+  {
+    return m_points[p];
+  }
+
+  const Lccb_face& face(uint32_t f) const
+  {
+    return m_faces[f];
+  }
+
+  const Lccb_object& object(uint32_t o) const
+  {
+    return m_objects[o];
+  }
+
+  const Lccb_volume& volume(uint32_t v) const
+  {
+    return m_volumes[v];
+  }
+
+  const Lccb_attribute& attribute(uint32_t a) const
+  {
+    return m_attributes[a];
+  }
+
+  std::string string(uint32_t s) const
+  {
+    return std::string(m_string_bytes + m_string_offsets[s], m_string_offsets[s + 1] - m_string_offsets[s]);
+  }
+
+  // Index of s in the string table, or lccb_none
+  uint32_t find_string(const std::string& s) const
+  {
+    for (uint64_t i = 0; i < m_header->string_count; i++)
+    {
+      if (m_string_offsets[i + 1] - m_string_offsets[i] == s.size() &&
+          std::memcmp(m_string_bytes + m_string_offsets[i], s.data(), s.size()) == 0)
+      {
+        return static_cast<uint32_t>(i);
+      }
+    }
+
+    return lccb_none;
+  }
+
+  // Index in the object table of the city object with the given id, or
+  // lccb_none, found by binary search
+  uint32_t find_object(const std::string& id) const
+  {
+    uint64_t low = 0, high = m_header->object_count;
+    while (low < high)
+    {
+      uint64_t middle = low + (high - low) / 2;
+      int order = compare_string(m_objects[middle].id, id);
+      if (order == 0)
+      {
+        return static_cast<uint32_t>(middle);
+      }
+      if (order < 0)
+      {
+        low = middle + 1;
+      }
+      else
+      {
+        high = middle;
+      }
+    }
+
+    return lccb_none;
+  }
+
+  // Faces of the city object with the given id
+  std::vector<uint32_t> faces_of_object(const std::string& id) const
+  {
+    std::vector<uint32_t> result;
+
+    uint32_t o = find_object(id);
+    if (o == lccb_none)
+    {
+      return result;
+    }
+
+    const Lccb_object& object = m_objects[o];
+    for (uint32_t f = object.first_face; f < object.first_face + object.face_count; f++)
+    {
+      result.push_back(f);
+    }
+
+    return result;
+  }
+
+  // Darts of face f, one per edge of each of its sides: the ring of its
+  // first dart by beta 1, then the one of its 3-sewn side. Empty if there is
+  // no face f.
+  std::vector<uint32_t> darts_of_face(uint32_t f) const
+  {
+    std::vector<uint32_t> result;
+    if (f >= m_header->face_count)
+    {
+      return result;
+    }
+
+    uint32_t first = m_faces[f].dart;
+    append_ring(first, result);
+    if (first < m_header->dart_count && m_darts[first].beta[2] != lccb_none)
+    {
+      append_ring(m_darts[first].beta[2], result);
+    }
+
+    return result;
+  }
+
+private:
+  // Appends the darts linked to first by beta 1, stopping at a free or out
+  // of range beta so that a damaged file cannot loop forever
+  void append_ring(uint32_t first, std::vector<uint32_t>& result) const
+  {
+    uint32_t d = first;
+    do
+    {
+      if (d >= m_header->dart_count || result.size() >= m_header->dart_count)
+      {
+        return;
+      }
+      result.push_back(d);
+      d = m_darts[d].beta[0];
+    } while (d != first);
+  }
+
+  // Compares string s of the file with id, as std::string::compare does
+  int compare_string(uint32_t s, const std::string& id) const
+  {
+    std::size_t size = static_cast<std::size_t>(m_string_offsets[s + 1] - m_string_offsets[s]);
+    int order = std::memcmp(m_string_bytes + m_string_offsets[s], id.data(), std::min(size, id.size()));
+    if (order != 0)
+    {
+      return order;
+    }
+
+    return size < id.size() ? -1 : size > id.size() ? 1 : 0;
+  }
+
+  // Table of count records at offset, which then moves past it and its
+  // padding. Throws runtime_error if the table does not fit in the file.
+  template <class Record>
+  const Record* table(uint64_t& offset, uint64_t count)
+  {
+    uint64_t start = offset;
+    add_lccb_table_size<Record>(offset, count, m_file.size());
+
+    return reinterpret_cast<const Record*>(m_file.data() + start);
+  }
+
+  Mapped_file m_file;
+  const Lccb_header* m_header;
+  const Lccb_dart* m_darts;
+  const Lccb_point* m_points;
+  const Lccb_face* m_faces;
+  const Lccb_object* m_objects;
+  const Lccb_volume* m_volumes;
+  const Lccb_attribute* m_attributes;
+  const uint64_t* m_string_offsets;
+  const char* m_string_bytes;
+};
+
+#endif
@@ -0,0 +1,173 @@
+#ifndef LCC_STATISTICS_H
+#define LCC_STATISTICS_H
+
+#include <cstdint>
+#include <ostream>
+#include <sstream>
+#include <vector>
+
+#include "typedefs.h"
+#include "flat_hash_map.h"
+#include "object_ids.h"
+#include "run_stats.h"
+#include "vertex_key.h"
+
+// Statistics of lcc from the sizes it keeps and the counters of the run that
+// built it, without a traversal. Every 0-cell has a point and, once the
+// reader initialized the cells, every 2-cell and 3-cell has an attribute.
+// The darts that beta 2 and 3 link around an edge form either a chain,
+// which has two free ends, or a ring, which gives the number of 1-cells.
+inline nlohmann::json lcc_statistics(const LCC& lcc, const Run_stats& stats)
+{
+  uint64_t darts = lcc.number_of_darts();
+  uint64_t free_darts[3] = {darts - stats.counter(COUNT_SEW_1),
+                            darts - 2 * stats.counter(COUNT_SEW_2),
+                            darts - 2 * stats.counter(COUNT_SEW_3)};
+
+  nlohmann::json report;
+  report["parsed_objects"] = stats.counter(COUNT_OBJECTS);
+  report["parsed_geometries"] = stats.counter(COUNT_GEOMETRIES);
+  report["darts"] = darts;
+  report["cells"] = {lcc.number_of_attributes<0>(),
+                     (free_darts[1] + free_darts[2]) / 2 + stats.counter(COUNT_EDGE_RINGS),
+                     lcc.number_of_attributes<2>(),
+                     lcc.number_of_attributes<3>()};
+  report["sews"] = {stats.counter(COUNT_SEW_1), stats.counter(COUNT_SEW_2), stats.counter(COUNT_SEW_3)};
+  report["free_darts"] = {free_darts[0], free_darts[1], free_darts[2]};
+  report["points"] = lcc.number_of_attributes<0>();
+  report["volume_colors"] = lcc.number_of_attributes<3>();
+
+  return report;
+}
+
+// Counters lcc_statistics needs, for a complex that was not reconstructed
+// in this run, such as a loaded one. One pass over the darts and cell
+// attributes, without marks: each ring is counted from its first dart.
+inline Run_stats count_lcc_statistics(const LCC& lcc)
+{
+  Run_stats stats;
+  stats.count(COUNT_DARTS, lcc.number_of_darts());
+
+  for (LCC::Dart_range::const_iterator it = lcc.darts().begin(); it != lcc.darts().end(); ++it)
+  {
+    LCC::Dart_const_handle d = it;
+    if (!lcc.is_free(d, 1))
+    {
+      stats.count(COUNT_SEW_1);
+    }
+    if (!lcc.is_free(d, 2) && &*d < &*lcc.beta(d, 2))
+    {
+      stats.count(COUNT_SEW_2);
+    }
+    if (!lcc.is_free(d, 3) && &*d < &*lcc.beta(d, 3))
+    {
+      stats.count(COUNT_SEW_3);
+    }
+
+    unsigned int dim = 2;
+    LCC::Dart_const_handle x = d;
+    while (!lcc.is_free(x, dim))
+    {
+      x = lcc.beta(x, dim);
+      dim = 5 - dim;
+      if (x == d)
+      {
+        stats.count(COUNT_EDGE_RINGS);
+        break;
+      }
+      if (&*x < &*d)
+      {
+        break;
+      }
+    }
+  }
+
+  std::vector<bool> objects(object_ids().size(), false);
+  for (auto it = lcc.attributes<3>().begin(); it != lcc.attributes<3>().end(); ++it)
+  {
+    uint32_t object = it->info().get_object_index();
+    if (object < objects.size() && !objects[object])
+    {
+      objects[object] = true;
+      stats.count(COUNT_OBJECTS);
+    }
+  }
+
+  Flat_hash_map<uint64_t, bool, Vertex_id_hash> geometries;
+  for (auto it = lcc.attributes<2>().begin(); it != lcc.attributes<2>().end(); ++it)
+  {
+    uint64_t key = (static_cast<uint64_t>(it->info().get_object_index()) << 32) |
+                   static_cast<uint32_t>(it->info().get_geometry_id());
+    if (geometries.find_or_insert(key, true).second)
+    {
+      stats.count(COUNT_GEOMETRIES);
+    }
+  }
+
+  return stats;
+}
+
+// Cells of each dimension and connected components counted by traversing
+// lcc, and whether it is valid. Each is a full pass with marks, so this is
+// only done on request.
+inline nlohmann::json lcc_validation(const LCC& lcc)
+{
+  std::vector<unsigned int> cells;
+  for (unsigned int dim = 0; dim <= 4; dim++)
+  {
+    cells.push_back(dim);
+  }
+  std::vector<unsigned int> counts = lcc.count_cells(cells);
+
+  nlohmann::json report;
+  report["cells"] = {counts[0], counts[1], counts[2], counts[3]};
+  report["connected_components"] = counts[4];
+  report["valid"] = lcc.is_valid();
+
+  return report;
+}
+
+// Prints the summary of statistics, as lcc_statistics() and, if it was
+// added under "validation", lcc_validation() report them
+inline void print_statistics(const nlohmann::json& statistics, std::ostream& output)
+{
+  const nlohmann::json& cells = statistics["cells"];
+  const nlohmann::json& sews = statistics["sews"];
+  const nlohmann::json& free_darts = statistics["free_darts"];
+
+  std::ostringstream os;
+
+  os << "Number of parsed objects: " << statistics["parsed_objects"]
+     << ", number of parsed geometries: " << statistics["parsed_geometries"]
+     << std::endl;
+
+  os << "Darts: " << statistics["darts"]
+     << ",  Vertices:" << cells[0]
+     << ",  (Points:" << statistics["points"] << ")"
+     << ",  Edges:" << cells[1]
+     << ",  Facets:" << cells[2]
+     << ",  Volumes:" << cells[3]
+     << ",  (Vol color:" << statistics["volume_colors"] << ")"
+     << std::endl;
+
+  os << "Sews: " << sews[0] << " 1-sews, " << sews[1] << " 2-sews, " << sews[2] << " 3-sews"
+     << ",  Free darts: " << free_darts[0] << " 1-free, " << free_darts[1] << " 2-free, " << free_darts[2] << " 3-free"
+     << std::endl;
+
+  if (statistics.find("validation") != statistics.end())
+  {
+    const nlohmann::json& validation = statistics["validation"];
+    const nlohmann::json& counted = validation["cells"];
+    os << "Counted by traversal: Vertices:" << counted[0]
+       << ",  Edges:" << counted[1]
+       << ",  Facets:" << counted[2]
+       << ",  Volumes:" << counted[3]
+       << ",  Connected components:" << validation["connected_components"]
+       << ",  Valid:" << (validation["valid"].get<bool>() ? "true" : "FALSE")
+       << std::endl;
+  }
+
+  output << os.str();
+}
+
+#endif
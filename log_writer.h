@@ -0,0 +1,89 @@
+#ifndef LOG_WRITER_H
+#define LOG_WRITER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+// Writes chunks of text to an output stream on a thread of its own, so the
+// caller never waits for the disk unless max_pending chunks are queued
+// already. This bounds the memory held by a log however long it gets.
+class Async_log_writer
+{
+public:
+  Async_log_writer(std::ostream& output, std::size_t max_pending) :
+    m_output(output), m_max_pending(max_pending), m_closed(false)
+  {
+    m_thread = std::thread([this]() { run(); });
+  }
+
+  ~Async_log_writer()
+  {
+    close();
+  }
+
+  Async_log_writer(const Async_log_writer&) = delete;
+  Async_log_writer& operator=(const Async_log_writer&) = delete;
+
+  void write(std::string chunk)
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_space.wait(lock, [this]() { return m_pending.size() < m_max_pending; });
+
+    m_pending.push_back(std::move(chunk));
+    m_ready.notify_one();
+  }
+
+  // Writes what is queued and stops the thread
+  void close()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_closed)
+      {
+        return;
+      }
+      m_closed = true;
+    }
+
+    m_ready.notify_one();
+    m_thread.join();
+    m_output.flush();
+  }
+
+private:
+  void run()
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+      m_ready.wait(lock, [this]() { return m_closed || !m_pending.empty(); });
+      if (m_pending.empty())
+      {
+        return;
+      }
+
+      std::string chunk = std::move(m_pending.front());
+      m_pending.pop_front();
+      m_space.notify_one();
+
+      lock.unlock();
+      m_output.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+      lock.lock();
+    }
+  }
+
+  std::ostream& m_output;
+  std::size_t m_max_pending;
+  bool m_closed;
+  std::deque<std::string> m_pending;
+  std::mutex m_mutex;
+  std::condition_variable m_ready, m_space;
+  std::thread m_thread;
+};
+
+#endif
@@ -12,6 +12,12 @@
 #include "typedefs.h"
 
 #include "cityjson_reader.h"
+#include "mapped_file.h"
+#include "darts_writer.h"
+#include "mesh_writer.h"
+#include "lcc_statistics.h"
+#include "lcc_binary.h"
+#include "cityjson_writer.h"
 
 using namespace std;
 
@@ -20,104 +26,30 @@ void show_help()
 	cout << "CityGML to Linear Complex Cell converter (for Combinatorial Map)" << endl;
 	cout << "============" << endl;
 	cout << "Usage: citygml input_file.json [options]" << endl;
+	cout << "       citygml input_file.lccb [options]	(load a binary LCC instead of reconstructing one)" << endl;
 	cout << "	options:" << endl;
 	cout << "		-o [output_file.3map]	Export the C-Map as 3map file" << endl;
 	cout << "		-off [output_file.off]	Export the C-Map as off file" << endl;
+	cout << "		-ply [output_file.ply]	Export the C-Map as binary ply file" << endl;
+	cout << "		-b [output_file.lccb]	Export the C-Map as binary LCC file" << endl;
 	cout << "		-p [precision]		Use the provided number of decimal digits for comparing coordinates" << endl;
+	cout << "		-q			Compare the integer coordinates of transformed files instead (ignores -p)" << endl;
 	cout << "		-s [starting_index]	Start from the provided index" << endl;
 	cout << "		-c [count]		Process only the provided number of city objects" << endl;
 	cout << "		-f [filter]		Process only objects where the id matches the provided filter" << endl;
 	cout << "		-n [new_cityjson.json]	Save the city model in a new CityJSON appended with the C-Map" << endl;
   cout << "		--only-lod [lod]	Only parse the specific LoD" << endl;
 	cout << "		-i			Clear the 2-free index after every city object" << endl;
-	cout << "		--show-log, -l		Show log in standard output" << endl;
-	cout << "		--show-statistics	Show statistics for the city model and lcc" << endl;
-}
-
-void append_cityjson(nlohmann::json& city, LCC lcc, CityJsonReader& reader)
-{
-	nlohmann::json darts;
-
-	std::map<LCC::Dart_const_handle, LCC::size_type> myDarts;
-
-	// First we numbered each dart by using the std::map.
-  LCC::Dart_range::const_iterator it(lcc.darts().begin());
-  for(LCC::size_type num=1; num<=lcc.number_of_darts(); ++num, ++it)
-  {
-    myDarts[it] = num;
-  }
-
-	// Now we save each dart, and its neighbors.
-	it=lcc.darts().begin();
-  for(LCC::size_type num=0; num<lcc.number_of_darts(); ++num, ++it)
-  {
-    nlohmann::json betas;
-    // the beta, only for non free sews
-    for(unsigned int dim=1; dim<=lcc.dimension; dim++)
-    {
-      if(!lcc.is_free(it, dim))
-      {
-        betas.push_back(myDarts[lcc.beta(it, dim)]);
-      }
-      else
-      {
-        betas.push_back(-1);
-      }
-    }
-
-    // Prepare the array with ids for semantics
-    nlohmann::json semanticSurface;
-    semanticSurface.push_back(lcc.info<2>(it).get_geometry_id());
-    semanticSurface.push_back(lcc.info<2>(it).get_semantic_surface_id());
-
-    darts["count"] = lcc.number_of_darts();
-    darts["vertices"].push_back(lcc.info<0>(it).vertex());
-    darts["betas"].push_back(betas);
-    darts["parentCityObjects"].push_back(lcc.info<2>(it).get_guid());
-    darts["semanticSurfaces"].push_back(semanticSurface);
-  }
-
-  city["+darts"] = darts;
-}
-
-void print_statistics(nlohmann::json& city, LCC lcc)
-{
-    std::vector<unsigned int> cells;
-    cells.push_back(0);
-    cells.push_back(1);
-    cells.push_back(2);
-    cells.push_back(3);
-    cells.push_back(4);
-
-    std::vector<unsigned int> res = lcc.count_cells (cells);
-
-    std::ostringstream os;
-
-    map<string, nlohmann::json> objs = city["CityObjects"];
-    int obj_count = objs.size();
-    int geom_count = 0;
-
-    for (auto& obj : objs)
-    {
-        geom_count += obj.second["geometry"].size();
-    }
-
-    os << "Number of objects: " << obj_count
-       << ", number of geometries: " << geom_count
-       << endl;
-
-    os << "Darts: " << lcc.number_of_darts ()
-       << ",  Vertices:" << res[0]
-       <<",  (Points:"<< lcc.number_of_attributes<0>()<<")"
-      << ",  Edges:" << res[1]
-      << ",  Facets:" << res[2]
-      << ",  Volumes:" << res[3]
-      <<",  (Vol color:"<< lcc.number_of_attributes<3>()<<")"
-     << ",  Connected components:" << res[4]
-     <<",  Valid:"<< (lcc.is_valid()?"true":"FALSE")
-    << endl;
-
-    cout << os.str();
+	cout << "		-j [threads]		Reconstruct city objects in parallel, 0 for all cores (implies -i)" << endl;
+	cout << "		-t [size]		Reconstruct square tiles of the provided size in parallel, on all cores unless -j is given, and stitch them" << endl;
+	cout << "		--show-log, -l		Stream the log to standard error" << endl;
+	cout << "		--log-file [file]	Stream the log to the provided file" << endl;
+	cout << "		--log-level [level]	Log only up to the provided level: 0 none, 1 setup, 2 everything (default), to standard error unless --log-file is given" << endl;
+	cout << "		--show-statistics	Show statistics for the parsed city objects and the lcc, counted while reconstructing" << endl;
+	cout << "		--validate		Show the statistics with the cells and connected components counted by traversing the lcc, and whether it is valid" << endl;
+	cout << "		--statistics [file.json]	Save the statistics as JSON" << endl;
+	cout << "		--timings [file.json]	Save the time of each phase and the operation counts as JSON" << endl;
+	cout << "		--stream		Stream the input instead of loading it in memory (objects are read in file order; with -t all of them are still kept in memory)" << endl;
 }
 
 int main(int argc, char *argv[])
@@ -132,16 +64,20 @@ int main(int argc, char *argv[])
 	const char *filename = argv[1];
 	const char *out_filename = "";
 	const char *off_filename = "";
+	const char *ply_filename = "";
+	const char *binary_filename = "";
 	const char *cityjson_filename = "";
 	const char *id_filter = "";
+	const char *timings_filename = "";
+	const char *statistics_filename = "";
 	bool show_log = false;
+	int log_level = -1;
 	bool show_statistics = false;
+	bool validate = false;
+	bool stream_input = false;
 
-	ifstream input_file(filename);
-	nlohmann::json city_model;
-	input_file >> city_model;
-
-	cout << "We found " << city_model["CityObjects"].size() << " root city objects!" << endl << endl;
+	// Opened before the reader, which streams its log to it until the end
+	ofstream log_file;
 
 	// Initialize the CityJSON reader
 	CityJsonReader reader;
@@ -155,11 +91,23 @@ int main(int argc, char *argv[])
 			off_filename = argv[++i];
 			cout << " - Will export off file as " << off_filename << endl;
 		}
+		else if (string(argv[i]) == "-ply") {
+			ply_filename = argv[++i];
+			cout << " - Will export ply file as " << ply_filename << endl;
+		}
+		else if (string(argv[i]) == "-b") {
+			binary_filename = argv[++i];
+			cout << " - Will export binary LCC file as " << binary_filename << endl;
+		}
 		else if (string(argv[i]) == "-n")
 		{
 			cityjson_filename = argv[++i];
 			cout << " - Will save the city model as " << cityjson_filename << endl;
 		}
+		else if (string(argv[i]) == "-q") {
+			reader.setIntegerMatching(true);
+			cout << " - Will compare vertices by their integer coordinates" << endl;
+		}
 		else if (string(argv[i]) == "-s") {
 			reader.setStartingIndex(static_cast<unsigned int>(atoi(argv[++i])));
 			cout << " - Will start from index " << reader.getStartingIndex() << endl;
@@ -180,14 +128,49 @@ int main(int argc, char *argv[])
 			reader.setIndexPerObject(true);
 			cout << " - Will only keep the 2-free index per city object" << endl;
 		}
+		else if (string(argv[i]) == "-j") {
+			reader.setThreadCount(static_cast<unsigned int>(atoi(argv[++i])));
+			cout << " - Will reconstruct city objects on " << reader.getThreadCount() << " threads" << endl;
+		}
+		else if (string(argv[i]) == "-t") {
+			reader.setTileSize(atof(argv[++i]));
+			cout << " - Will reconstruct tiles of size " << reader.getTileSize() << endl;
+		}
 		else if (string(argv[i]) == "-l" || string(argv[i]) == "--show-log")
 		{
 			show_log = true;
 		}
+		else if (string(argv[i]) == "--log-file")
+		{
+			log_file.open(argv[++i]);
+			cout << " - Will write the log to " << argv[i] << endl;
+		}
+		else if (string(argv[i]) == "--log-level")
+		{
+			log_level = min(max(atoi(argv[++i]), 0), static_cast<int>(LOG_DEBUG));
+		}
 		else if (string(argv[i]) == "--show-statistics")
 		{
 			show_statistics = true;
 		}
+		else if (string(argv[i]) == "--validate")
+		{
+			validate = true;
+		}
+		else if (string(argv[i]) == "--statistics")
+		{
+			statistics_filename = argv[++i];
+			cout << " - Will save the statistics as " << statistics_filename << endl;
+		}
+		else if (string(argv[i]) == "--timings")
+		{
+			timings_filename = argv[++i];
+			cout << " - Will save the timings as " << timings_filename << endl;
+		}
+		else if (string(argv[i]) == "--stream")
+		{
+			stream_input = true;
+		}
     else if (string(argv[i]) == "--only-lod")
     {
         reader.setLodFilter(atoi(argv[++i]));
@@ -195,36 +178,151 @@ int main(int argc, char *argv[])
     }
 	}
 
-	LCC lcc = reader.readCityModel(city_model);
-
-	if (out_filename != nullptr && out_filename[0] != '\0')
+	// The log is only formatted when it goes somewhere, to the log file or
+	// else to standard error, at everything unless --log-level says otherwise
+	if (show_log || log_file.is_open() || log_level >= 0)
 	{
-		save_combinatorial_map(lcc, out_filename);
+		reader.setLogLevel(log_level >= 0 ? static_cast<Log_level>(log_level) : LOG_DEBUG);
+		if (log_file.is_open())
+		{
+			reader.setLogOutput(log_file);
+		}
+		else
+		{
+			reader.setLogOutput(cerr);
+		}
 	}
 
-	if (off_filename != nullptr && off_filename[0] != '\0')
+	Mapped_file input_file(filename);
+	if (!input_file.is_open())
 	{
-		write_off(lcc, off_filename);
+		cerr << "Cannot read " << filename << endl;
+		return 1;
 	}
 
-	if (cityjson_filename != nullptr && cityjson_filename[0] != '\0')
+	Run_stats& stats = reader.getStats();
+	Run_stats::Clock::time_point start;
+
+	string input_name(filename);
+	bool binary_input = input_name.size() >= 5 && input_name.compare(input_name.size() - 5, 5, ".lccb") == 0;
+
+	// Errors of the input, from parsing it to validating it, end the run
+	// with their message instead of aborting it
+	try
 	{
-    append_cityjson(city_model, lcc, reader);
+		nlohmann::json city_model;
+		if (!stream_input && !binary_input)
+		{
+			start = Run_stats::Clock::now();
+			city_model = nlohmann::json::parse(input_file.begin(), input_file.end());
+			stats.add_time(PHASE_LOAD_JSON, start);
+		}
 
-		ofstream output_file(cityjson_filename);
-		output_file << city_model;
-	}
+		// The reconstructed complex is the reader's own; only a loaded one lives
+		// here. Neither is copied by the exports below.
+		LCC loaded_lcc;
+		start = Run_stats::Clock::now();
+		if (binary_input)
+		{
+			load_lcc_binary(filename, loaded_lcc);
+			stats.add_time(PHASE_LOAD_BINARY, start);
+		}
+		const LCC& lcc = binary_input ? loaded_lcc :
+		                 stream_input ? reader.readCityModel(input_file.data(), input_file.size()) : reader.readCityModel(city_model);
+
+		if (out_filename != nullptr && out_filename[0] != '\0')
+		{
+			start = Run_stats::Clock::now();
+			save_combinatorial_map(lcc, out_filename);
+			stats.add_time(PHASE_EXPORT_3MAP, start);
+		}
+
+		if (off_filename != nullptr && off_filename[0] != '\0')
+		{
+			start = Run_stats::Clock::now();
+			ofstream off_file(off_filename);
+			write_mesh_off(off_file, lcc);
+			off_file.close();
+			stats.add_time(PHASE_EXPORT_OFF, start);
+		}
+
+		if (ply_filename != nullptr && ply_filename[0] != '\0')
+		{
+			start = Run_stats::Clock::now();
+			ofstream ply_file(ply_filename, ios::binary);
+			write_mesh_ply(ply_file, lcc);
+			ply_file.close();
+			stats.add_time(PHASE_EXPORT_PLY, start);
+		}
+
+		if (binary_filename != nullptr && binary_filename[0] != '\0')
+		{
+			start = Run_stats::Clock::now();
+			save_lcc_binary(lcc, binary_filename);
+			stats.add_time(PHASE_EXPORT_BINARY, start);
+		}
 
-	if (show_log)
+		if (binary_input && cityjson_filename != nullptr && cityjson_filename[0] != '\0')
+		{
+			cerr << "Cannot save a CityJSON file from a binary LCC input" << endl;
+		}
+		else if (cityjson_filename != nullptr && cityjson_filename[0] != '\0')
+		{
+			start = Run_stats::Clock::now();
+			ofstream output_file(cityjson_filename);
+			if (stream_input)
+			{
+				copy_cityjson_with_darts(input_file, output_file, lcc);
+			}
+			else
+			{
+				write_cityjson_with_darts(output_file, city_model, lcc);
+			}
+			output_file.close();
+			stats.add_time(PHASE_EXPORT_CITYJSON, start);
+		}
+
+		if (timings_filename != nullptr && timings_filename[0] != '\0')
+		{
+			ofstream timings_file(timings_filename);
+			timings_file << stats.to_json().dump(2) << endl;
+		}
+
+		// Counted while reconstructing; only a loaded complex needs a pass
+		nlohmann::json statistics;
+		if (show_statistics || validate || (statistics_filename != nullptr && statistics_filename[0] != '\0'))
+		{
+			statistics = lcc_statistics(lcc, binary_input ? count_lcc_statistics(lcc) : stats);
+			if (validate)
+			{
+				statistics["validation"] = lcc_validation(lcc);
+			}
+		}
+
+		if (statistics_filename != nullptr && statistics_filename[0] != '\0')
+		{
+			ofstream statistics_file(statistics_filename);
+			statistics_file << statistics.dump(2) << endl;
+		}
+
+		reader.closeLog();
+
+		if (show_log)
+		{
+			cout << reader.getIndex();
+		}
+
+		if (show_statistics || validate)
+		  {
+		    print_statistics(statistics, cout);
+		  }
+	}
+	catch (const exception& e)
 	{
-		cout << reader.getLog();
-		cout << reader.getIndex();
+		reader.closeLog();
+		cerr << "Error: " << e.what() << endl;
+		return 1;
 	}
 
-	if (show_statistics)
-	  {
-	    print_statistics(city_model, lcc);
-	  }
-
 	return 0;
 }
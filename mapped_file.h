@@ -0,0 +1,116 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+// Without POSIX mmap, or when built with CITYJSON2LCC_NO_MMAP, the whole file
+// is read into a buffer instead, which the parsers read from the same way
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(CITYJSON2LCC_NO_MMAP)
+#define MAPPED_FILE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#include <vector>
+#endif
+
+// Read-only memory mapping of a whole file. The parsers read straight from
+// the mapping, so the input is neither copied into a stream buffer nor kept
+// twice in memory next to the page cache.
+class Mapped_file
+{
+public:
+#ifdef MAPPED_FILE_MMAP
+  explicit Mapped_file(const std::string& filename) : m_data(nullptr), m_size(0)
+  {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+      return;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+    {
+      void* data = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data != MAP_FAILED)
+      {
+        m_data = static_cast<const char*>(data);
+        m_size = static_cast<std::size_t>(info.st_size);
+        madvise(data, m_size, MADV_SEQUENTIAL);
+      }
+    }
+
+    close(fd);
+  }
+
+  ~Mapped_file()
+  {
+    if (m_data != nullptr)
+    {
+      munmap(const_cast<char*>(m_data), m_size);
+    }
+  }
+#else
+  explicit Mapped_file(const std::string& filename) : m_data(nullptr), m_size(0)
+  {
+    std::ifstream input(filename.c_str(), std::ios::binary | std::ios::ate);
+    if (!input)
+    {
+      return;
+    }
+
+    std::streamoff size = input.tellg();
+    if (size > 0)
+    {
+      m_buffer.resize(static_cast<std::size_t>(size));
+      input.seekg(0);
+      if (input.read(m_buffer.data(), size))
+      {
+        m_data = m_buffer.data();
+        m_size = m_buffer.size();
+      }
+    }
+  }
+#endif
+
+  Mapped_file(const Mapped_file&) = delete;
+  Mapped_file& operator=(const Mapped_file&) = delete;
+
+  bool is_open() const
+  {
+    return m_data != nullptr;
+  }
+
+  const char* data() const
+  {
+    return m_data;
+  }
+
+  std::size_t size() const
+  {
+    return m_size;
+  }
+
+  const char* begin() const
+  {
+    return m_data;
+  }
+
+  const char* end() const
+  {
+    return m_data + m_size;
+  }
+
+private:
+  const char* m_data;
+  std::size_t m_size;
+#ifndef MAPPED_FILE_MMAP
+  std::vector<char> m_buffer;
+#endif
+};
+
+#endif
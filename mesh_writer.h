@@ -0,0 +1,145 @@
+#ifndef MESH_WRITER_H
+#define MESH_WRITER_H
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "typedefs.h"
+#include "buffered_writer.h"
+#include "dart_numbering.h"
+
+// Indexed mesh of an LCC: one vertex per vertex attribute, so each 0-cell
+// is written once with its point, numbered in attribute order, and one face
+// per 2-cell, whatever the number of volumes sharing it.
+class Lcc_mesh
+{
+public:
+  explicit Lcc_mesh(const LCC& lcc) : m_lcc(lcc)
+  {
+    m_vertices.reserve(lcc.number_of_attributes<0>());
+
+    uint32_t num = 0;
+    for (LCC::Vertex_attribute_const_range::const_iterator it = lcc.vertex_attributes().begin();
+         it != lcc.vertex_attributes().end(); ++it)
+    {
+      m_vertices.find_or_insert(it, num++);
+      m_points.push_back(it);
+    }
+
+    for (LCC::One_dart_per_cell_const_range<2>::const_iterator
+         it(lcc.one_dart_per_cell<2>().begin());
+         it.cont(); ++it)
+      m_faces.push_back(it);
+  }
+
+  std::size_t number_of_vertices() const
+  {
+    return m_points.size();
+  }
+
+  std::size_t number_of_faces() const
+  {
+    return m_faces.size();
+  }
+
+  const Point& point(std::size_t v) const
+  {
+    return m_points[v]->point();
+  }
+
+  // Vertex indices of face f, in the order of its darts. The vector is
+  // reused by the next call.
+  const std::vector<uint32_t>& face(std::size_t f)
+  {
+    m_face.clear();
+
+    LCC::Dart_const_handle first = m_faces[f];
+    LCC::Dart_const_handle d = first;
+    do
+    {
+      m_face.push_back(m_vertices.find(m_lcc.vertex_attribute(d))->value);
+      if (m_lcc.is_free(d, 1))
+        break;
+      d = m_lcc.beta(d, 1);
+    } while (d != first);
+
+    return m_face;
+  }
+
+private:
+  const LCC& m_lcc;
+  Flat_hash_map<LCC::Vertex_attribute_const_handle, uint32_t, Handle_hash> m_vertices;
+  std::vector<LCC::Vertex_attribute_const_handle> m_points;
+  std::vector<LCC::Dart_const_handle> m_faces;
+  std::vector<uint32_t> m_face;
+};
+
+// Writes lcc as an OFF file
+inline void write_mesh_off(std::ostream& output, const LCC& lcc)
+{
+  Lcc_mesh mesh(lcc);
+  Buffered_writer writer(output);
+
+  writer.put("OFF\n");
+  writer.put_integer(static_cast<int64_t>(mesh.number_of_vertices()));
+  writer.put(' ');
+  writer.put_integer(static_cast<int64_t>(mesh.number_of_faces()));
+  writer.put(" 0\n");
+
+  for (std::size_t v = 0; v < mesh.number_of_vertices(); v++)
+  {
+    const Point& p = mesh.point(v);
+    writer.put_double(CGAL::to_double(p.x()));
+    writer.put(' ');
+    writer.put_double(CGAL::to_double(p.y()));
+    writer.put(' ');
+    writer.put_double(CGAL::to_double(p.z()));
+    writer.put('\n');
+  }
+
+  for (std::size_t f = 0; f < mesh.number_of_faces(); f++)
+  {
+    const std::vector<uint32_t>& vertices = mesh.face(f);
+    writer.put_integer(static_cast<int64_t>(vertices.size()));
+    for (uint32_t v : vertices)
+    {
+      writer.put(' ');
+      writer.put_integer(v);
+    }
+    writer.put('\n');
+  }
+}
+
+// Writes lcc as a binary PLY file in the byte order of the host, with double
+// coordinates. Output must be opened in binary mode.
+inline void write_mesh_ply(std::ostream& output, const LCC& lcc)
+{
+  Lcc_mesh mesh(lcc);
+  Buffered_writer writer(output);
+
+  writer.put("ply\nformat ");
+  writer.put(Buffered_writer::host_is_little_endian() ? "binary_little_endian" : "binary_big_endian");
+  writer.put(" 1.0\nelement vertex ");
+  writer.put_integer(static_cast<int64_t>(mesh.number_of_vertices()));
+  writer.put("\nproperty double x\nproperty double y\nproperty double z\nelement face ");
+  writer.put_integer(static_cast<int64_t>(mesh.number_of_faces()));
+  writer.put("\nproperty list uint int vertex_indices\nend_header\n");
+
+  for (std::size_t v = 0; v < mesh.number_of_vertices(); v++)
+  {
+    const Point& p = mesh.point(v);
+    double coordinates[3] = {CGAL::to_double(p.x()), CGAL::to_double(p.y()), CGAL::to_double(p.z())};
+    writer.put_bytes(coordinates, sizeof(coordinates));
+  }
+
+  for (std::size_t f = 0; f < mesh.number_of_faces(); f++)
+  {
+    const std::vector<uint32_t>& vertices = mesh.face(f);
+    uint32_t count = static_cast<uint32_t>(vertices.size());
+    writer.put_bytes(&count, sizeof(count));
+    writer.put_bytes(vertices.data(), vertices.size() * sizeof(uint32_t));
+  }
+}
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef OBJECT_IDS_H
+#define OBJECT_IDS_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "flat_hash_map.h"
+
+// Interned city object ids. Face and volume attributes keep the 32-bit index
+// of their object instead of a copy of its id; index 0 is "nothing", the id
+// of attributes not set yet.
+class Object_id_table
+{
+public:
+  Object_id_table()
+  {
+    intern("nothing");
+  }
+
+  // Index of id, added to the table if needed
+  uint32_t intern(const std::string& id)
+  {
+    uint32_t next_index = static_cast<uint32_t>(m_ids.size());
+    auto entry = m_indices.find_or_insert(id, next_index);
+    if (entry.second)
+    {
+      m_ids.push_back(id);
+    }
+
+    return entry.first->value;
+  }
+
+  const std::string& id(uint32_t index) const
+  {
+    return m_ids[index];
+  }
+
+  std::size_t size() const
+  {
+    return m_ids.size();
+  }
+
+private:
+  std::vector<std::string> m_ids;
+  Flat_hash_map<std::string, uint32_t, std::hash<std::string> > m_indices;
+};
+
+// The table shared by every LCC of the process. It has to be global as the
+// .3map attribute readers and writers get no other context. Interning is not
+// thread-safe: the parallel modes intern on the main thread before handing
+// objects to the workers, which only look ids up.
+inline Object_id_table& object_ids()
+{
+  static Object_id_table table;
+  return table;
+}
+
+#endif
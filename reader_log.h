@@ -0,0 +1,147 @@
+#ifndef READER_LOG_H
+#define READER_LOG_H
+
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+#include "log_writer.h"
+
+enum Log_level
+{
+  LOG_NONE,
+  LOG_INFO,  // Setup of the reconstruction, once per run
+  LOG_DEBUG  // Every object, geometry, polygon and sewing
+};
+
+// Log of the reader. Messages are only formatted when their level is
+// enabled, which is never the case when built with CITYJSON2LCC_NO_LOG.
+// They are kept in memory unless the log streams to an output, in which
+// case they are handed to a writer thread in chunks of chunk_size bytes.
+// A log kept in memory can be limited in size, past which it is truncated.
+class Reader_log
+{
+public:
+  static const std::size_t chunk_size = 1 << 20;
+  static const std::size_t max_pending_chunks = 16;
+
+  // Bytes kept in memory by the logs of the parallel workers together
+  static const std::size_t max_worker_bytes = 64 * chunk_size;
+
+  Reader_log() : m_level(LOG_NONE), m_limit(0), m_truncated(false)
+  {}
+
+  ~Reader_log()
+  {
+    close();
+  }
+
+  bool enabled(Log_level level) const
+  {
+#ifdef CITYJSON2LCC_NO_LOG
+    (void)level;
+    return false;
+#else
+    return level != LOG_NONE && level <= m_level && !m_truncated;
+#endif
+  }
+
+  Log_level level() const
+  {
+    return m_level;
+  }
+
+  void set_level(Log_level level)
+  {
+    m_level = level;
+  }
+
+  std::ostream& stream()
+  {
+    return m_str;
+  }
+
+  // What is still in memory: the whole log unless it streams to an output
+  std::string str() const
+  {
+    return m_str.str();
+  }
+
+  // Streams the log to output from now on; output has to outlive the log
+  // or its close()
+  void stream_to(std::ostream& output)
+  {
+    close();
+    m_writer.reset(new Async_log_writer(output, max_pending_chunks));
+    flush();
+  }
+
+  // Stops a log kept in memory once it holds limit bytes or more, 0 for no
+  // limit. The message that reaches the limit is kept whole.
+  void set_limit(std::size_t limit)
+  {
+    m_limit = limit;
+  }
+
+  bool truncated() const
+  {
+    return m_truncated;
+  }
+
+  // Called after each message: hands the buffer to the writer once full, or
+  // truncates the log once it reaches its limit
+  void written()
+  {
+    if (m_writer && static_cast<std::size_t>(m_str.tellp()) >= chunk_size)
+    {
+      flush();
+    }
+    else if (!m_writer && m_limit > 0 && static_cast<std::size_t>(m_str.tellp()) >= m_limit)
+    {
+      m_truncated = true;
+    }
+  }
+
+  // Hands what is buffered to the writer, if any
+  void flush()
+  {
+    if (m_writer && m_str.tellp() > 0)
+    {
+      m_writer->write(m_str.str());
+      m_str.str("");
+    }
+  }
+
+  // Writes everything out and stops streaming
+  void close()
+  {
+    if (m_writer)
+    {
+      flush();
+      m_writer->close();
+      m_writer.reset();
+    }
+  }
+
+private:
+  Log_level m_level;
+  std::size_t m_limit;
+  bool m_truncated;
+  std::ostringstream m_str;
+  std::unique_ptr<Async_log_writer> m_writer;
+};
+
+// Writes message, a chain of operator<< operands, to log if level is
+// enabled; the operands are not evaluated otherwise
+#define READER_LOG(log, level, message) \
+  do \
+  { \
+    if ((log).enabled(level)) \
+    { \
+      (log).stream() << message; \
+      (log).written(); \
+    } \
+  } while (0)
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef RUN_STATS_H
+#define RUN_STATS_H
+
+#include <chrono>
+#include <cstdint>
+
+#include "thirdparty/json.hpp"
+
+// Phases of a run, timed in wall-clock seconds
+enum Run_phase
+{
+  PHASE_LOAD_JSON,
+  PHASE_LOAD_BINARY,
+  PHASE_DECODE_VERTICES,
+  PHASE_PARSE_OBJECTS,
+  PHASE_MERGE,
+  PHASE_INIT_CELLS,
+  PHASE_EXPORT_3MAP,
+  PHASE_EXPORT_OFF,
+  PHASE_EXPORT_PLY,
+  PHASE_EXPORT_CITYJSON,
+  PHASE_EXPORT_BINARY,
+  PHASE_COUNT
+};
+
+// Operations counted during the reconstruction. The sews count the pairs of
+// darts linked, so a 3-sew counts one per edge of the face, and the edge
+// rings count the links that closed the darts around an edge into a ring.
+enum Run_counter
+{
+  COUNT_OBJECTS,
+  COUNT_GEOMETRIES,
+  COUNT_POLYGONS,
+  COUNT_DARTS,
+  COUNT_INDEX_0_LOOKUPS,
+  COUNT_INDEX_1_LOOKUPS,
+  COUNT_INDEX_2_LOOKUPS,
+  COUNT_SEW_1,
+  COUNT_SEW_2,
+  COUNT_SEW_3,
+  COUNT_EDGE_RINGS,
+  COUNT_COUNT
+};
+
+// Time and number of runs of each phase and the counters of a run. The
+// counters are plain increments, cheap enough to stay on in the inner loop;
+// each parallel worker has its own and they are added up when merged.
+class Run_stats
+{
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  Run_stats()
+  {
+    for (int p = 0; p < PHASE_COUNT; p++)
+    {
+      m_seconds[p] = 0;
+      m_runs[p] = 0;
+    }
+    for (int c = 0; c < COUNT_COUNT; c++)
+    {
+      m_counters[c] = 0;
+    }
+  }
+
+  void add_time(Run_phase phase, Clock::time_point start)
+  {
+    m_seconds[phase] += std::chrono::duration<double>(Clock::now() - start).count();
+    m_runs[phase]++;
+  }
+
+  void count(Run_counter counter, uint64_t n = 1)
+  {
+    m_counters[counter] += n;
+  }
+
+  uint64_t counter(Run_counter counter) const
+  {
+    return m_counters[counter];
+  }
+
+  // Adds the counters of other, not its times: the phases of workers
+  // overlap, their wall time is the one of the phase that ran them
+  void add_counters(const Run_stats& other)
+  {
+    for (int c = 0; c < COUNT_COUNT; c++)
+    {
+      m_counters[c] += other.m_counters[c];
+    }
+  }
+
+  nlohmann::json to_json() const
+  {
+    static const char* phase_names[PHASE_COUNT] = {
+      "load_json", "load_binary", "decode_vertices", "parse_objects", "merge",
+      "init_cells", "export_3map", "export_off", "export_ply", "export_cityjson", "export_binary"
+    };
+    static const char* counter_names[COUNT_COUNT] = {
+      "objects", "geometries", "polygons", "darts", "index_0_lookups", "index_1_lookups",
+      "index_2_lookups", "sew_1", "sew_2", "sew_3", "edge_rings"
+    };
+
+    nlohmann::json report;
+    for (int p = 0; p < PHASE_COUNT; p++)
+    {
+      if (m_runs[p] > 0)
+      {
+        report["phases"][phase_names[p]]["seconds"] = m_seconds[p];
+        report["phases"][phase_names[p]]["runs"] = m_runs[p];
+      }
+    }
+    for (int c = 0; c < COUNT_COUNT; c++)
+    {
+      report["counters"][counter_names[c]] = m_counters[c];
+    }
+
+    return report;
+  }
+
+private:
+  double m_seconds[PHASE_COUNT];
+  uint64_t m_runs[PHASE_COUNT];
+  uint64_t m_counters[COUNT_COUNT];
+};
+
+#endif
@@ -2,6 +2,7 @@
 #define TYPEDEFS_H
 
 #include "thirdparty/json.hpp"
+#include "object_ids.h"
 
 #include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
 
@@ -14,6 +15,36 @@
 #include <CGAL/Timer.h>
 #include <stdlib.h>
 
+#ifdef CITYJSON2LCC_COUNT_COPIES
+#include <atomic>
+#include <cstdint>
+
+// Member counting the copies of the cell info it belongs to. Only built in
+// the copy check, which makes sure with it that no whole complex is copied.
+template <class Info>
+struct Info_copy_counter
+{
+  static std::atomic<uint64_t>& copies()
+  {
+    static std::atomic<uint64_t> count(0);
+    return count;
+  }
+
+  Info_copy_counter() {}
+
+  Info_copy_counter(const Info_copy_counter&)
+  {
+    copies()++;
+  }
+
+  Info_copy_counter& operator=(const Info_copy_counter&)
+  {
+    copies()++;
+    return *this;
+  }
+};
+#endif
+
 // Use to define properties on volumes.
 #define LCC_DEMO_VISIBLE 1 // if not visible => hidden
 #define LCC_DEMO_FILLED  2 // if not filled, wireframe
@@ -38,6 +69,16 @@ private:
   unsigned long m_vertex = 0;
 };
 
+// What a face was built from: the index of its city object in object_ids(),
+// the index of the geometry in that object and its semantic surface, -1 if
+// it has none. Set once per polygon.
+struct Face_record
+{
+  uint32_t object;
+  int32_t geometry_id;
+  int32_t semantic_surface_id;
+};
+
 class Face_info
 {
   friend void CGAL::read_cmap_attribute_node<Face_info>
@@ -46,44 +87,68 @@ class Face_info
   friend void CGAL::write_cmap_attribute_node<Face_info>(boost::property_tree::ptree & node,
                                                            const Face_info& arg);
 public:
-  Face_info() : m_guid("nothing"),
-    m_geometry_id(0),
-    m_semantic_surface(-1)
-  {}
+  Face_info()
+  {
+    m_record.object = 0;
+    m_record.geometry_id = 0;
+    m_record.semantic_surface_id = -1;
+  }
 
-  void set_guid(std::string guid)
+  const Face_record& record() const
   {
-    m_guid = guid;
+    return m_record;
   }
 
-  std::string get_guid() const
+  void set_record(const Face_record& record)
   {
-    return m_guid;
+    m_record = record;
+  }
+
+  void set_guid(const std::string& guid)
+  {
+    m_record.object = object_ids().intern(guid);
+  }
+
+  const std::string& get_guid() const
+  {
+    return object_ids().id(m_record.object);
+  }
+
+  void set_object_index(uint32_t object)
+  {
+    m_record.object = object;
+  }
+
+  uint32_t get_object_index() const
+  {
+    return m_record.object;
   }
 
   void set_geometry_id(int geometry_id)
   {
-    m_geometry_id = geometry_id;
+    m_record.geometry_id = geometry_id;
   }
 
   int get_geometry_id() const
   {
-    return m_geometry_id;
+    return m_record.geometry_id;
   }
 
   void set_semantic_surface_id(int semantic_surface_id)
   {
-    m_semantic_surface = semantic_surface_id;
+    m_record.semantic_surface_id = semantic_surface_id;
   }
 
   int get_semantic_surface_id() const
   {
-    return m_semantic_surface;
+    return m_record.semantic_surface_id;
   }
 
 private:
-  std::string m_guid;
-  int m_geometry_id, m_semantic_surface;
+  Face_record m_record;
+#ifdef CITYJSON2LCC_COUNT_COPIES
+  Info_copy_counter<Face_info> m_copies;
+#endif
 };
 
 class Volume_info
@@ -96,7 +161,7 @@ class Volume_info
 public:
   Volume_info() : m_color(CGAL::Color(rand() % 256, rand() % 256, rand() % 256)),
     m_status( LCC_DEMO_VISIBLE | LCC_DEMO_FILLED ),
-    m_guid("nothing")
+    m_object(0)
   {}
 
   CGAL::Color& color()
@@ -133,14 +198,24 @@ public:
     else       m_status = m_status ^ LCC_DEMO_FILLED;
   }
 
-  void set_guid(std::string guid)
+  void set_guid(const std::string& guid)
+  {
+  	m_object = object_ids().intern(guid);
+  }
+
+  const std::string& get_guid() const
   {
-  	m_guid = guid;
+  	return object_ids().id(m_object);
   }
 
-  std::string get_guid() const
+  void set_object_index(uint32_t object)
   {
-  	return m_guid;
+    m_object = object;
+  }
+
+  uint32_t get_object_index() const
+  {
+    return m_object;
   }
 
   void set_attributes(std::map<std::string, std::string> attributes)
@@ -148,7 +223,7 @@ public:
       m_attributes = attributes;
   }
 
-  std::map<std::string, std::string> get_attributes()
+  const std::map<std::string, std::string>& get_attributes() const
   {
       return m_attributes;
   }
@@ -161,8 +236,11 @@ public:
 private:
   CGAL::Color m_color;
   char        m_status;
-  std::string m_guid;
+  uint32_t    m_object;
   std::map<std::string, std::string> m_attributes;
+#ifdef CITYJSON2LCC_COUNT_COPIES
+  Info_copy_counter<Volume_info> m_copies;
+#endif
 };
 
 namespace CGAL
@@ -174,7 +252,7 @@ inline void read_cmap_attribute_node<Face_info>
 {
   try
   {
-    val.m_guid = v.second.get<std::string>("guid");
+    val.set_guid(v.second.get<std::string>("guid"));
   }
   catch(const std::exception &  )
   {}
@@ -186,7 +264,7 @@ inline void write_cmap_attribute_node<Face_info>(boost::property_tree::ptree & n
                                                    const Face_info& arg)
 {
   boost::property_tree::ptree & nValue = node.add("v","");
-  nValue.add("guid",arg.m_guid);
+  nValue.add("guid",arg.get_guid());
 }
 
 template<>
@@ -212,7 +290,7 @@ inline void read_cmap_attribute_node<Volume_info>
 
   try
   {
-  	val.m_guid = v.second.get<std::string>("guid");
+  	val.set_guid(v.second.get<std::string>("guid"));
   }
   catch(const std::exception &  )
   {}
@@ -241,7 +319,7 @@ inline void write_cmap_attribute_node<Volume_info>(boost::property_tree::ptree &
   nValue.add("color-r",(int)arg.m_color.r());
   nValue.add("color-g",(int)arg.m_color.g());
   nValue.add("color-b",(int)arg.m_color.b());
-  nValue.add("guid",arg.m_guid);
+  nValue.add("guid",arg.get_guid());
   for (auto it = arg.m_attributes.begin(); it != arg.m_attributes.end(); ++it)
   {
       nValue.add("attributes." + it->first, it->second);
@@ -0,0 +1,195 @@
+#ifndef VERTEX_BUFFER_H
+#define VERTEX_BUFFER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "typedefs.h"
+#include "vertex_key.h"
+#include "vertex_transform.h"
+
+// The "vertices" of a city model decoded once into a flat array, x, y and z
+// packed per vertex. Integer coordinates (as stored by transformed files) are
+// kept as int32; as soon as a coordinate is not such an integer the whole
+// buffer switches to doubles. The transform is applied when a point is
+// requested, or to all vertices at once by build_points().
+class Vertex_buffer
+{
+public:
+  Vertex_buffer() : m_integer(true)
+  {
+    for (int d = 0; d < 3; d++)
+    {
+      m_scale[d] = 1;
+      m_translate[d] = 0;
+    }
+  }
+
+  void clear()
+  {
+    m_quantized.clear();
+    m_coordinates.clear();
+    m_points.clear();
+    m_integer = true;
+  }
+
+  void set_transform(const double scale[3], const double translate[3])
+  {
+    for (int d = 0; d < 3; d++)
+    {
+      m_scale[d] = scale[d];
+      m_translate[d] = translate[d];
+    }
+  }
+
+  const double* scale() const
+  {
+    return m_scale;
+  }
+
+  const double* translate() const
+  {
+    return m_translate;
+  }
+
+  // Appends the next coordinate (x, y and z of each vertex in turn)
+  void add(int64_t value)
+  {
+    if (m_integer && value >= std::numeric_limits<int32_t>::min() && value <= std::numeric_limits<int32_t>::max())
+    {
+      m_quantized.push_back(static_cast<int32_t>(value));
+    }
+    else
+    {
+      add(static_cast<double>(value));
+    }
+  }
+
+  void add(double value)
+  {
+    if (m_integer)
+    {
+      switch_to_doubles();
+    }
+
+    m_coordinates.push_back(value);
+  }
+
+  // Decodes a "vertices" array of a CityJSON document
+  void load(const nlohmann::json& vertices)
+  {
+    clear();
+    m_quantized.reserve(vertices.size() * 3);
+
+    for (const nlohmann::json& v : vertices)
+    {
+      for (const nlohmann::json& c : v)
+      {
+        if (c.is_number_integer())
+        {
+          add(c.get<int64_t>());
+        }
+        else
+        {
+          add(c.get<double>());
+        }
+      }
+    }
+  }
+
+  // Whether all coordinates are int32, so they can be used as keys as they are
+  bool is_integer() const
+  {
+    return m_integer;
+  }
+
+  std::size_t size() const
+  {
+    return (m_integer ? m_quantized.size() : m_coordinates.size()) / 3;
+  }
+
+  const int32_t* quantized_data() const
+  {
+    return m_quantized.data();
+  }
+
+  const double* coordinate_data() const
+  {
+    return m_coordinates.data();
+  }
+
+  // Converts every vertex to a Point once, so shared vertices are not
+  // transformed again for every reference. Integer coordinates go through
+  // the vector kernels of vertex_transform.h.
+  void build_points(Simd_level level = best_simd_level())
+  {
+    const std::size_t n = size();
+    const std::size_t chunk = 4096;
+    std::vector<double> world(3 * chunk);
+
+    m_points.clear();
+    m_points.reserve(n);
+    for (std::size_t first = 0; first < n; first += chunk)
+    {
+      const std::size_t count = std::min(chunk, n - first);
+      if (m_integer)
+      {
+        transform_vertices(&m_quantized[3 * first], count, m_scale, m_translate, world.data(), level);
+      }
+      else
+      {
+        for (std::size_t k = 0; k < 3 * count; k++)
+        {
+          world[k] = m_coordinates[3 * first + k] * m_scale[k % 3] + m_translate[k % 3];
+        }
+      }
+
+      for (std::size_t k = 0; k < count; k++)
+      {
+        m_points.push_back(Point(world[3 * k], world[3 * k + 1], world[3 * k + 2]));
+      }
+    }
+  }
+
+  Point point(std::size_t i) const
+  {
+    if (!m_points.empty())
+    {
+      return m_points[i];
+    }
+
+    double c[3];
+    for (int d = 0; d < 3; d++)
+    {
+      double raw = m_integer ? m_quantized[3 * i + d] : m_coordinates[3 * i + d];
+      c[d] = raw * m_scale[d] + m_translate[d];
+    }
+
+    return Point(c[0], c[1], c[2]);
+  }
+
+  Vertex_key integer_key(std::size_t i) const
+  {
+    Vertex_key k = {m_quantized[3 * i], m_quantized[3 * i + 1], m_quantized[3 * i + 2], 0};
+    return k;
+  }
+
+private:
+  void switch_to_doubles()
+  {
+    m_coordinates.assign(m_quantized.begin(), m_quantized.end());
+    std::vector<int32_t>().swap(m_quantized);
+    m_integer = false;
+  }
+
+  std::vector<int32_t> m_quantized;
+  std::vector<double> m_coordinates;
+  std::vector<Point> m_points;
+  bool m_integer;
+  double m_scale[3];
+  double m_translate[3];
+};
+
+#endif
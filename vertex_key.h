@@ -0,0 +1,186 @@
+#ifndef VERTEX_KEY_H
+#define VERTEX_KEY_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "typedefs.h"
+
+// Identity of a 0-cell in the reconstruction indexes: the coordinates of a
+// point quantized to integers at the configured number of decimal digits,
+// see quantize_coordinate. A coordinate too large to quantize is kept as its
+// bit pattern instead, with its bit (1 for x, 2 for y, 4 for z) set in
+// unquantized, see make_vertex_key.
+struct Vertex_key
+{
+  int64_t x, y, z;
+  uint32_t unquantized;
+
+  bool operator==(const Vertex_key& other) const
+  {
+    return x == other.x && y == other.y && z == other.z && unquantized == other.unquantized;
+  }
+
+  bool operator!=(const Vertex_key& other) const
+  {
+    return !(*this == other);
+  }
+
+  bool operator<(const Vertex_key& other) const
+  {
+    if (x != other.x) return x < other.x;
+    if (y != other.y) return y < other.y;
+    if (z != other.z) return z < other.z;
+    return unquantized < other.unquantized;
+  }
+};
+
+inline uint64_t mix_key_bits(uint64_t h)
+{
+  // Finalizer of MurmurHash3, good avalanche for a few multiplications
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+inline uint64_t combine_key_bits(uint64_t seed, uint64_t v)
+{
+  return mix_key_bits(seed ^ (v + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2)));
+}
+
+struct Vertex_key_hash
+{
+  std::size_t operator()(const Vertex_key& k) const
+  {
+    uint64_t h = mix_key_bits(static_cast<uint64_t>(k.x));
+    h = combine_key_bits(h, static_cast<uint64_t>(k.y));
+    h = combine_key_bits(h, static_cast<uint64_t>(k.z));
+    if (k.unquantized != 0)
+    {
+      h = combine_key_bits(h, k.unquantized);
+    }
+    return static_cast<std::size_t>(h);
+  }
+};
+
+inline std::ostream& operator<<(std::ostream& os, const Vertex_key& k)
+{
+  os << k.x << "-" << k.y << "-" << k.z;
+  if (k.unquantized != 0)
+  {
+    os << "-u" << k.unquantized;
+  }
+  return os;
+}
+
+// Quantized value of negative coordinates that round to zero, which print
+// as "-0.000" and so did not match the positive ones
+const int64_t negative_zero_key = std::numeric_limits<int64_t>::min();
+
+// Bound of the quantized coordinates, below 2^63
+const double quantized_limit = 9e18;
+
+// Coordinate c quantized at precision decimal digits (factor is 10 to that
+// power) the way `fixed << setprecision(precision)` rounds it, from its exact
+// binary value. The rounded product is used when it is far enough from a
+// tie for its rounding error not to matter, which is nearly always; the
+// rest is printed as the old string keys were. Throws out_of_range when the
+// quantized coordinate does not fit 63 bits, which make_vertex_key avoids.
+inline int64_t quantize_coordinate(double c, int precision, double factor)
+{
+  double r = c * factor;
+  if (!(std::fabs(r) < quantized_limit))
+  {
+    throw std::out_of_range("Coordinate " + std::to_string(c) + " does not fit in 64 bits at precision " +
+                            std::to_string(precision));
+  }
+
+  int64_t q;
+  double distance_to_tie = std::fabs(r - std::floor(r) - 0.5);
+  if (precision >= 0 && precision <= 22 &&
+      distance_to_tie > 4 * std::numeric_limits<double>::epsilon() * (std::fabs(r) + 1))
+  {
+    q = static_cast<int64_t>(std::llround(r));
+  }
+  else
+  {
+    int length = std::snprintf(nullptr, 0, "%.*f", precision, c);
+    std::vector<char> text(static_cast<std::size_t>(length) + 1);
+    std::snprintf(text.data(), text.size(), "%.*f", precision, c);
+
+    q = 0;
+    for (char digit : text)
+    {
+      if (digit >= '0' && digit <= '9')
+      {
+        q = q * 10 + (digit - '0');
+      }
+    }
+    if (text[0] == '-')
+    {
+      q = -q;
+    }
+  }
+
+  return q == 0 && std::signbit(c) ? negative_zero_key : q;
+}
+
+// Key of coordinate c, flagged in unquantized when it is too large to be
+// quantized. Doubles that large are more than 10^-precision apart, so they
+// print the same exactly when they are equal and their bits are as good a
+// key as their digits.
+inline int64_t coordinate_key(double c, int precision, double factor, uint32_t flag, uint32_t& unquantized)
+{
+  if (std::fabs(c * factor) < quantized_limit)
+  {
+    return quantize_coordinate(c, precision, factor);
+  }
+
+  int64_t bits;
+  std::memcpy(&bits, &c, sizeof(bits));
+  unquantized |= flag;
+  return bits;
+}
+
+// Two points get the same key exactly when they print the same with
+// `fixed << setprecision(precision)`, as the old string keys did, at any
+// precision
+inline Vertex_key make_vertex_key(const Point& p, int precision, double factor)
+{
+  Vertex_key k;
+  k.unquantized = 0;
+  k.x = coordinate_key(p.x(), precision, factor, 1, k.unquantized);
+  k.y = coordinate_key(p.y(), precision, factor, 2, k.unquantized);
+  k.z = coordinate_key(p.z(), precision, factor, 4, k.unquantized);
+  return k;
+}
+
+// Hash of the dense vertex ids handed out by the reader (and of keys packed
+// from them).
+struct Vertex_id_hash
+{
+  std::size_t operator()(uint64_t id) const
+  {
+    return static_cast<std::size_t>(mix_key_bits(id));
+  }
+};
+
+// Undirected edge between two vertex ids packed in 64 bits, key of the 1-cell
+// index. Both half-edges of an edge share the key.
+inline uint64_t make_edge_key(uint32_t v1, uint32_t v2)
+{
+  return v1 < v2 ? (static_cast<uint64_t>(v1) << 32) | v2
+                 : (static_cast<uint64_t>(v2) << 32) | v1;
+}
+
+#endif
@@ -0,0 +1,149 @@
+#ifndef VERTEX_TRANSFORM_H
+#define VERTEX_TRANSFORM_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Batch conversion of quantized CityJSON vertices to world coordinates:
+// out[3i+d] = in[3i+d] * scale[d] + translate[d] for count packed x,y,z
+// vertices. The vector kernels multiply then add (no FMA), so all variants
+// give bit-identical results to the scalar one.
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(CITYJSON2LCC_NO_SIMD)
+#define VERTEX_TRANSFORM_X86 1
+#include <immintrin.h>
+#endif
+
+enum Simd_level
+{
+  SIMD_SCALAR,
+  SIMD_SSE2,
+  SIMD_AVX2
+};
+
+inline const char* simd_level_name(Simd_level level)
+{
+  switch (level)
+  {
+  case SIMD_AVX2:
+    return "avx2";
+  case SIMD_SSE2:
+    return "sse2";
+  default:
+    return "scalar";
+  }
+}
+
+inline void transform_vertices_scalar(const int32_t* in, std::size_t count,
+                                      const double scale[3], const double translate[3], double* out)
+{
+  for (std::size_t i = 0; i < count; i++)
+  {
+    for (int d = 0; d < 3; d++)
+    {
+      out[3 * i + d] = in[3 * i + d] * scale[d] + translate[d];
+    }
+  }
+}
+
+#ifdef VERTEX_TRANSFORM_X86
+
+// Two doubles per register: the x,y,z pattern repeats every 6 coordinates
+__attribute__((target("sse2")))
+inline void transform_vertices_sse2(const int32_t* in, std::size_t count,
+                                    const double scale[3], const double translate[3], double* out)
+{
+  const __m128d s0 = _mm_setr_pd(scale[0], scale[1]);
+  const __m128d s1 = _mm_setr_pd(scale[2], scale[0]);
+  const __m128d s2 = _mm_setr_pd(scale[1], scale[2]);
+  const __m128d t0 = _mm_setr_pd(translate[0], translate[1]);
+  const __m128d t1 = _mm_setr_pd(translate[2], translate[0]);
+  const __m128d t2 = _mm_setr_pd(translate[1], translate[2]);
+
+  const std::size_t n = count * 3;
+  std::size_t i = 0;
+  for (; i + 6 <= n; i += 6)
+  {
+    __m128d a = _mm_cvtepi32_pd(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i)));
+    __m128d b = _mm_cvtepi32_pd(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i + 2)));
+    __m128d c = _mm_cvtepi32_pd(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i + 4)));
+    _mm_storeu_pd(out + i, _mm_add_pd(_mm_mul_pd(a, s0), t0));
+    _mm_storeu_pd(out + i + 2, _mm_add_pd(_mm_mul_pd(b, s1), t1));
+    _mm_storeu_pd(out + i + 4, _mm_add_pd(_mm_mul_pd(c, s2), t2));
+  }
+
+  transform_vertices_scalar(in + i, (n - i) / 3, scale, translate, out + i);
+}
+
+// Four doubles per register: the x,y,z pattern repeats every 12 coordinates
+__attribute__((target("avx2")))
+inline void transform_vertices_avx2(const int32_t* in, std::size_t count,
+                                    const double scale[3], const double translate[3], double* out)
+{
+  const __m256d s0 = _mm256_setr_pd(scale[0], scale[1], scale[2], scale[0]);
+  const __m256d s1 = _mm256_setr_pd(scale[1], scale[2], scale[0], scale[1]);
+  const __m256d s2 = _mm256_setr_pd(scale[2], scale[0], scale[1], scale[2]);
+  const __m256d t0 = _mm256_setr_pd(translate[0], translate[1], translate[2], translate[0]);
+  const __m256d t1 = _mm256_setr_pd(translate[1], translate[2], translate[0], translate[1]);
+  const __m256d t2 = _mm256_setr_pd(translate[2], translate[0], translate[1], translate[2]);
+
+  const std::size_t n = count * 3;
+  std::size_t i = 0;
+  for (; i + 12 <= n; i += 12)
+  {
+    __m256d a = _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)));
+    __m256d b = _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 4)));
+    __m256d c = _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 8)));
+    _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_mul_pd(a, s0), t0));
+    _mm256_storeu_pd(out + i + 4, _mm256_add_pd(_mm256_mul_pd(b, s1), t1));
+    _mm256_storeu_pd(out + i + 8, _mm256_add_pd(_mm256_mul_pd(c, s2), t2));
+  }
+
+  transform_vertices_scalar(in + i, (n - i) / 3, scale, translate, out + i);
+}
+
+#endif // VERTEX_TRANSFORM_X86
+
+inline Simd_level detect_simd_level()
+{
+#ifdef VERTEX_TRANSFORM_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+  {
+    return SIMD_AVX2;
+  }
+  if (__builtin_cpu_supports("sse2"))
+  {
+    return SIMD_SSE2;
+  }
+#endif
+  return SIMD_SCALAR;
+}
+
+inline Simd_level best_simd_level()
+{
+  static const Simd_level level = detect_simd_level();
+  return level;
+}
+
+// Runs the best kernel the CPU supports, or the one requested by level
+inline void transform_vertices(const int32_t* in, std::size_t count,
+                               const double scale[3], const double translate[3], double* out,
+                               Simd_level level = best_simd_level())
+{
+  switch (level)
+  {
+#ifdef VERTEX_TRANSFORM_X86
+  case SIMD_AVX2:
+    transform_vertices_avx2(in, count, scale, translate, out);
+    break;
+  case SIMD_SSE2:
+    transform_vertices_sse2(in, count, scale, translate, out);
+    break;
+#endif
+  default:
+    transform_vertices_scalar(in, count, scale, translate, out);
+  }
+}
+
+#endif